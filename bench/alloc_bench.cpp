@@ -0,0 +1,123 @@
+#include <iostream>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <new>
+#include <cstddef>
+#include <algorithm>
+#include <memory_resource>
+
+#include "parser.h"
+#include "corpus.h"
+
+using namespace bbcode::lexer;
+using namespace bbcode::parser;
+using namespace bbcode::bench;
+
+static usize allocations = 0;
+
+// std::pmr::new_delete_resource() uses the aligned forms, count them too.
+void *operator new(std::size_t size, std::align_val_t align) {
+  ++allocations;
+  auto alignment = std::max(std::size_t(align), sizeof(void *));
+  if (void *p = std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void *operator new(std::size_t size) {
+  return operator new(size, std::align_val_t(alignof(std::max_align_t)));
+}
+
+void operator delete(void *p) noexcept {
+  std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept {
+  std::free(p);
+}
+
+void operator delete(void *p, std::align_val_t) noexcept {
+  std::free(p);
+}
+
+void operator delete(void *p, std::size_t, std::align_val_t) noexcept {
+  std::free(p);
+}
+
+static const usize POSTS = 20000;
+static const usize ARENA_SIZE = 64 * 1024;
+
+struct Result {
+  f64 ns;
+  f64 allocations;
+};
+
+template<class F>
+static Result measure(const std::vector<std::string> &posts, F f) {
+  auto before = allocations;
+  auto begin = std::chrono::steady_clock::now();
+  for (const auto &post : posts) {
+    f(post);
+  }
+  auto elapsed = std::chrono::steady_clock::now() - begin;
+  return Result {
+      .ns = f64(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()) / f64(posts.size()),
+      .allocations = f64(allocations - before) / f64(posts.size()),
+  };
+}
+
+int main() {
+  Random random(1);
+  std::vector<std::string> posts;
+  posts.reserve(POSTS);
+  for (usize i = 0; i < POSTS; ++i) {
+    posts.push_back(generate_post(random, 64 + random.below(2048)));
+  }
+
+  usize nodes = 0;
+  auto count = [&nodes](Node &&node) {
+    nodes += node.children.size() + 1;
+  };
+
+  Parser parser(count, [](Message &&) {});
+  Lexer lexer([&parser](LexItem &&item) {
+    parser.put(std::move(item));
+  });
+
+  // warm up reused buffers of parser and lexer
+  measure(posts, [&](const std::string &post) {
+    parser.reset();
+    lexer.reset();
+    lexer.put(post);
+    lexer.finish();
+  });
+
+  auto heap = measure(posts, [&](const std::string &post) {
+    parser.reset();
+    lexer.reset();
+    lexer.put(post);
+    lexer.finish();
+  });
+
+  std::vector<std::byte> arena(ARENA_SIZE);
+  std::pmr::monotonic_buffer_resource resource(arena.data(), arena.size());
+
+  auto monotonic = measure(posts, [&](const std::string &post) {
+    resource.release();
+    parser.reset(&resource);
+    lexer.reset(&resource);
+    lexer.put(post);
+    lexer.finish();
+  });
+
+  std::cout << "heap:      " << heap.ns << " ns/post, "
+            << heap.allocations << " allocations/post" << std::endl;
+  std::cout << "monotonic: " << monotonic.ns << " ns/post, "
+            << monotonic.allocations << " allocations/post" << std::endl;
+  std::cout << "(" << nodes << " nodes)" << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,233 @@
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <chrono>
+#include <vector>
+#include <fstream>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "writer.h"
+#include "engine.h"
+#include "corpus.h"
+
+using namespace bbcode::lexer;
+using namespace bbcode::parser;
+using namespace bbcode::writer;
+using namespace bbcode::engine;
+using namespace bbcode::bench;
+
+enum Phase {
+  /// lexer only
+  LexerPhase = 0,
+
+  /// lexer and parser
+  ParserPhase,
+
+  /// lexer, parser and JSON output, as `parser_tool`
+  JsonPhase,
+
+  /// `Engine`, same work as parser
+  FusedPhase,
+};
+
+static const char *PHASE_NAMES[] = {"lexer", "parser", "json", "fused"};
+
+struct Options {
+  usize size = 1 << 20;
+  f64 time = 0.5;
+  usize repeat = 1;
+  std::string filter;
+  std::string output;
+  bool json = false;
+};
+
+struct Result {
+  Scenario scenario;
+  Phase phase;
+  usize bytes;
+  usize tokens;
+  // median of average seconds per run over repetitions
+  f64 seconds;
+  // 95% confidence interval of the median
+  f64 ci_low;
+  f64 ci_high;
+  usize samples;
+};
+
+/// Runs whole input through one phase, reusing lexer/parser state.
+class Runner {
+ private:
+  usize tokens = 0;
+  std::stringstream ss;
+  Phase phase;
+  Parser parser;
+  Lexer lexer;
+  Engine engine;
+
+ public:
+  explicit Runner(Phase phase)
+      : phase(phase),
+        parser([this](Node &&node) {
+          if (this->phase == JsonPhase && node.type != NodeType::End) {
+            write_json(node, &this->ss);
+          }
+        }, [](Message &&) {}),
+        lexer([this](LexItem &&item) {
+          ++this->tokens;
+          if (this->phase != LexerPhase) {
+            this->parser.put(std::move(item));
+          }
+        }),
+        engine([](Node &&) {}, [](Message &&) {}) {}
+
+  /// Tokens the lexer made, zero for `FusedPhase`.
+  usize run(std::string_view input) {
+    if (this->phase == FusedPhase) {
+      this->engine.reset();
+      this->engine.put(input);
+      this->engine.finish();
+      return 0;
+    }
+
+    this->tokens = 0;
+    this->ss.str("");
+    this->lexer.reset();
+    this->parser.reset();
+    this->lexer.put(input);
+    this->lexer.finish();
+    return this->tokens;
+  }
+};
+
+static Result measure(Scenario scenario, Phase phase, const std::string &input, const Options &options) {
+  Runner runner(phase);
+  auto tokens = runner.run(input);
+  if (phase == FusedPhase) {
+    tokens = Runner(LexerPhase).run(input);
+  }
+
+  std::vector<f64> samples;
+  for (usize i = 0; i < options.repeat; ++i) {
+    usize runs = 0;
+    auto begin = std::chrono::steady_clock::now();
+    std::chrono::duration<f64> elapsed {};
+    do {
+      runner.run(input);
+      ++runs;
+      elapsed = std::chrono::steady_clock::now() - begin;
+    } while (elapsed.count() < options.time);
+    samples.push_back(elapsed.count() / f64(runs));
+  }
+
+  std::sort(samples.begin(), samples.end());
+  auto n = samples.size();
+  auto median = n % 2 ? samples[n / 2] : (samples[n / 2 - 1] + samples[n / 2]) / 2;
+
+  // distribution free interval of the median from order statistics
+  auto spread = 1.96 * std::sqrt(f64(n)) / 2;
+  auto low = usize(std::max(0.0, std::floor(f64(n) / 2 - spread)));
+  auto high = std::min(n - 1, usize(std::ceil(f64(n) / 2 + spread)));
+
+  return Result {
+      .scenario = scenario,
+      .phase = phase,
+      .bytes = input.size(),
+      .tokens = tokens,
+      .seconds = median,
+      .ci_low = samples[low],
+      .ci_high = samples[high],
+      .samples = n,
+  };
+}
+
+static void write_json_results(const std::vector<Result> &results, const Options &options, std::ostream *o) {
+  *o << std::setprecision(9);
+  *o << R"({"size":)" << options.size << R"(,"results":[)";
+  for (auto it = results.begin(); it != results.end(); ++it) {
+    *o << R"({"scenario":")" << scenario_name(it->scenario)
+       << R"(","phase":")" << PHASE_NAMES[it->phase]
+       << R"(","bytes":)" << it->bytes
+       << R"(,"tokens":)" << it->tokens
+       << R"(,"seconds":)" << it->seconds
+       << R"(,"ci_low":)" << it->ci_low
+       << R"(,"ci_high":)" << it->ci_high
+       << R"(,"samples":)" << it->samples
+       << R"(,"mb_per_s":)" << f64(it->bytes) / it->seconds / 1e6
+       << R"(,"ns_per_token":)" << it->seconds * 1e9 / f64(it->tokens) << "}";
+    if (it + 1 != results.end()) {
+      *o << ",";
+    }
+  }
+  *o << "]}" << std::endl;
+}
+
+static void write_table(const std::vector<Result> &results, std::ostream *o) {
+  *o << std::left << std::setw(10) << "scenario" << std::setw(8) << "phase"
+     << std::right << std::setw(12) << "MB/s" << std::setw(14) << "ns/token" << std::endl;
+  for (const auto &result : results) {
+    *o << std::left << std::setw(10) << scenario_name(result.scenario)
+       << std::setw(8) << PHASE_NAMES[result.phase] << std::right << std::fixed
+       << std::setprecision(2) << std::setw(12) << f64(result.bytes) / result.seconds / 1e6
+       << std::setw(14) << result.seconds * 1e9 / f64(result.tokens) << std::endl;
+  }
+}
+
+int main(int argc, char ** argv) {
+  Options options;
+
+  for (int i = 1; i < argc; ++i) {
+    auto arg = std::string_view(argv[i]);
+    if (arg == "--size" && i + 1 < argc) {
+      options.size = std::strtoul(argv[++i], nullptr, 10);
+    } else if (arg == "--time" && i + 1 < argc) {
+      options.time = std::strtod(argv[++i], nullptr);
+    } else if (arg == "--repeat" && i + 1 < argc) {
+      options.repeat = std::max(1ul, std::strtoul(argv[++i], nullptr, 10));
+    } else if (arg == "--output" && i + 1 < argc) {
+      options.output = argv[++i];
+    } else if (arg == "--filter" && i + 1 < argc) {
+      options.filter = argv[++i];
+    } else if (arg == "--json") {
+      options.json = true;
+    } else {
+      std::cerr << "Usage: bbcode_bench [--size bytes] [--time seconds] [--repeat n] "
+                   "[--filter scenario] [--json] [--output file]" << std::endl;
+      exit(1);
+    }
+  }
+
+  std::vector<Result> results;
+  for (usize s = 0; s < SCENARIO_COUNT; ++s) {
+    auto scenario = Scenario(s);
+    if (!options.filter.empty() &&
+        std::string_view(scenario_name(scenario)).find(options.filter) == std::string_view::npos) {
+      continue;
+    }
+
+    auto input = generate(scenario, options.size);
+    for (auto phase : {LexerPhase, ParserPhase, JsonPhase, FusedPhase}) {
+      results.push_back(measure(scenario, phase, input, options));
+    }
+  }
+
+  std::ostream *output = &std::cout;
+  std::ofstream file_out;
+  if (!options.output.empty()) {
+    file_out = std::ofstream(options.output, std::ios::binary | std::ios::trunc);
+    if (!file_out.is_open()) {
+      std::cerr << "Failed opening file: " << options.output << " for write." << std::endl;
+      exit(1);
+    }
+    output = &file_out;
+  }
+
+  if (options.json) {
+    write_json_results(results, options, output);
+  } else {
+    write_table(results, output);
+  }
+
+  return 0;
+}
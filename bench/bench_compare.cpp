@@ -0,0 +1,226 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+
+#include "defs.h"
+
+/// One measured (scenario, phase) pair of `bbcode_bench --json` output.
+struct Entry {
+  usize bytes = 0;
+  f64 seconds = 0;
+  f64 ci_low = 0;
+  f64 ci_high = 0;
+};
+
+typedef std::map<std::pair<std::string, std::string>, Entry> Results;
+
+static std::string trim(const std::string &s) {
+  auto begin = s.find_first_not_of(" \t\r\n");
+  auto end = s.find_last_not_of(" \t\r\n");
+  return begin == std::string::npos ? "" : s.substr(begin, end - begin + 1);
+}
+
+/// Read the flat result objects written by `bbcode_bench --json`.
+static bool read_results(const std::string &path, Results &results) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open()) {
+    return false;
+  }
+
+  std::stringstream ss;
+  ss << file.rdbuf();
+  auto text = ss.str();
+
+  auto begin = text.find('[');
+  while (begin != std::string::npos) {
+    begin = text.find('{', begin);
+    if (begin == std::string::npos) {
+      break;
+    }
+
+    auto end = text.find('}', begin);
+    if (end == std::string::npos) {
+      return false;
+    }
+
+    std::string scenario;
+    std::string phase;
+    Entry entry;
+    std::istringstream object(text.substr(begin + 1, end - begin - 1));
+    std::string pair;
+    while (std::getline(object, pair, ',')) {
+      pair = trim(pair);
+      auto colon = pair.find(':');
+      if (colon == std::string::npos || pair.size() < 2 || pair[0] != '"') {
+        return false;
+      }
+
+      auto key = trim(pair.substr(0, colon));
+      key = key.substr(1, key.size() - 2);
+      auto value = trim(pair.substr(colon + 1));
+      if (!value.empty() && value.front() == '"') {
+        value = value.substr(1, value.size() - 2);
+      }
+
+      if (key == "scenario") {
+        scenario = value;
+      } else if (key == "phase") {
+        phase = value;
+      } else if (key == "bytes") {
+        entry.bytes = std::strtoul(value.c_str(), nullptr, 10);
+      } else if (key == "seconds") {
+        entry.seconds = std::strtod(value.c_str(), nullptr);
+      } else if (key == "ci_low") {
+        entry.ci_low = std::strtod(value.c_str(), nullptr);
+      } else if (key == "ci_high") {
+        entry.ci_high = std::strtod(value.c_str(), nullptr);
+      }
+    }
+
+    if (scenario.empty() || phase.empty() || entry.bytes == 0) {
+      return false;
+    }
+
+    if (entry.ci_high == 0) {
+      entry.ci_low = entry.ci_high = entry.seconds;
+    }
+
+    results[{scenario, phase}] = entry;
+    begin = end;
+  }
+
+  return !results.empty();
+}
+
+static f64 ns_per_byte(f64 seconds, usize bytes) {
+  return seconds * 1e9 / f64(bytes);
+}
+
+/// Time of one phase in ns/B, median with confidence interval.
+struct Phase {
+  f64 median = 0;
+  f64 low = 0;
+  f64 high = 0;
+};
+
+/// Time of phase `measured` less phase `before`, if both were measured.
+/// The interval of a difference spans from the lowest to the highest
+/// difference the two intervals allow.
+static bool phase_time(const Results &results, const std::string &scenario,
+                       const char *measured, const char *before, Phase &phase) {
+  auto m = results.find({scenario, measured});
+  if (m == results.end()) {
+    return false;
+  }
+
+  auto bytes = m->second.bytes;
+  phase.median = ns_per_byte(m->second.seconds, bytes);
+  phase.low = ns_per_byte(m->second.ci_low, bytes);
+  phase.high = ns_per_byte(m->second.ci_high, bytes);
+  if (before) {
+    auto b = results.find({scenario, before});
+    if (b == results.end()) {
+      return false;
+    }
+    phase.median -= ns_per_byte(b->second.seconds, b->second.bytes);
+    phase.low -= ns_per_byte(b->second.ci_high, b->second.bytes);
+    phase.high -= ns_per_byte(b->second.ci_low, b->second.bytes);
+  }
+  return true;
+}
+
+int main(int argc, char ** argv) {
+  f64 threshold = 5;
+  std::vector<std::string> files;
+
+  for (int i = 1; i < argc; ++i) {
+    auto arg = std::string_view(argv[i]);
+    if (arg == "--threshold" && i + 1 < argc) {
+      threshold = std::strtod(argv[++i], nullptr);
+    } else if (arg.size() > 1 && arg[0] == '-') {
+      files.clear();
+      break;
+    } else {
+      files.emplace_back(arg);
+    }
+  }
+
+  if (files.size() != 2) {
+    std::cerr << "Usage: bench_compare [--threshold percent] baseline.json current.json" << std::endl;
+    exit(2);
+  }
+
+  Results baseline;
+  Results current;
+  for (auto [path, results] : {std::pair {&files[0], &baseline}, std::pair {&files[1], &current}}) {
+    if (!read_results(*path, *results)) {
+      std::cerr << "Failed reading benchmark results: " << *path << std::endl;
+      exit(2);
+    }
+  }
+
+  // phase breakdown: parser and serializer time are the difference to the
+  // phase before, as each phase runs everything before it.
+  static const std::pair<const char *, const char *> BREAKDOWN[] = {
+      {"lexer", nullptr},
+      {"parser", "lexer"},
+      {"json", "parser"},
+      {"fused", nullptr},
+  };
+  static const char *BREAKDOWN_NAMES[] = {"lexer", "parser", "serializer", "fused"};
+
+  std::vector<std::string> regressions;
+  std::cout << std::left << std::setw(10) << "scenario" << std::setw(12) << "phase"
+            << std::right << std::setw(12) << "base ns/B" << std::setw(12) << "curr ns/B"
+            << std::setw(10) << "change" << std::endl;
+
+  std::string last_scenario;
+  for (const auto &[key, base] : baseline) {
+    const auto &[scenario, phase] = key;
+    if (scenario == last_scenario) {
+      continue;
+    }
+    last_scenario = scenario;
+
+    for (usize i = 0; i < std::size(BREAKDOWN); ++i) {
+      auto [measured, before] = BREAKDOWN[i];
+      Phase base, curr;
+      if (!phase_time(baseline, scenario, measured, before, base) ||
+          !phase_time(current, scenario, measured, before, curr)) {
+        std::cout << std::left << std::setw(10) << (i == 0 ? scenario : "")
+                  << std::setw(12) << BREAKDOWN_NAMES[i] << "  not in both results" << std::endl;
+        continue;
+      }
+
+      auto change = base.median > 0 ? (curr.median / base.median - 1) * 100 : 0;
+      std::cout << std::left << std::setw(10) << (i == 0 ? scenario : "")
+                << std::setw(12) << BREAKDOWN_NAMES[i] << std::right << std::fixed
+                << std::setprecision(2) << std::setw(12) << base.median << std::setw(12) << curr.median
+                << std::showpos << std::setw(9) << change << '%' << std::noshowpos;
+
+      // a phase regresses when the printed change is beyond threshold and
+      // its confidence intervals do not overlap.
+      if (change > threshold && curr.low > base.high) {
+        std::cout << "  REGRESSION";
+        regressions.push_back(scenario + "/" + measured);
+      }
+      std::cout << std::endl;
+    }
+  }
+
+  if (!regressions.empty()) {
+    std::cout << regressions.size() << " regression(s) beyond " << threshold << "%:";
+    for (const auto &name : regressions) {
+      std::cout << " " << name;
+    }
+    std::cout << std::endl;
+    return 1;
+  }
+
+  std::cout << "No regression beyond " << threshold << "%." << std::endl;
+  return 0;
+}
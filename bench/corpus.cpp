@@ -0,0 +1,239 @@
+#include "corpus.h"
+#include <array>
+
+namespace bbcode::bench {
+
+static const auto SCENARIO_NAMES = std::array {
+    "prose",
+    "chat",
+    "tags",
+    "nested",
+    "tables",
+    "code",
+    "garbage",
+};
+
+static const auto WORDS = std::array {
+    "the", "of", "and", "to", "in", "is", "you", "that", "it", "he",
+    "was", "for", "on", "are", "as", "with", "his", "they", "at", "be",
+    "this", "have", "from", "or", "one", "had", "by", "word", "but", "not",
+    "what", "all", "were", "we", "when", "your", "can", "said", "there",
+    "use", "an", "each", "which", "she", "do", "how", "their", "if", "will",
+    "forum", "thread", "reply", "update", "patch", "release", "server",
+};
+
+static const auto CONSTANTS = std::array {
+    ":)", ":(", ":-)", "{:1_01:}", "{:1_02:}", "{:1_03:}", "{:1_04:}",
+};
+
+static const auto COLORS = std::array {
+    "red", "Blue", "#ff8800", "darkgreen", "#ABC", "gray",
+};
+
+static const auto SIZES = std::array {
+    "1", "3", "7", "12px", "1.5em", "large",
+};
+
+static const auto INLINE = std::array {
+    "b", "i", "x",
+};
+
+const char *scenario_name(Scenario scenario) {
+  return SCENARIO_NAMES[scenario];
+}
+
+u64 Random::next() {
+  u64 z = (this->state += 0x9e3779b97f4a7c15);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+  return z ^ (z >> 31);
+}
+
+template<class T>
+static const char *pick(Random &random, const T &list) {
+  return list[random.below(list.size())];
+}
+
+static void sentence(Random &random, std::string &out, usize words) {
+  for (usize i = 0; i < words; ++i) {
+    if (i != 0) {
+      out += ' ';
+    }
+    out += pick(random, WORDS);
+  }
+  out += random.chance(20) ? "?" : ".";
+}
+
+static void inline_tag(Random &random, std::string &out) {
+  switch (random.below(6)) {
+    case 0:
+    case 1: {
+      auto name = pick(random, INLINE);
+      out += '[';
+      out += name;
+      out += ']';
+      out += pick(random, WORDS);
+      out += "[/";
+      out += name;
+      out += ']';
+      break;
+    }
+    case 2:
+      out += "[color=";
+      out += pick(random, COLORS);
+      out += ']';
+      out += pick(random, WORDS);
+      out += "[/color]";
+      break;
+    case 3:
+      out += "[size=";
+      out += pick(random, SIZES);
+      out += ']';
+      out += pick(random, WORDS);
+      out += "[/size]";
+      break;
+    case 4:
+      out += "[font=\"Times New Roman\", serif]";
+      out += pick(random, WORDS);
+      out += "[/font]";
+      break;
+    default:
+      out += "[url=http://example.com/";
+      out += pick(random, WORDS);
+      out += ']';
+      out += pick(random, WORDS);
+      out += "[/url]";
+      break;
+  }
+}
+
+static void prose(Random &random, std::string &out) {
+  for (usize i = 0, n = 3 + random.below(5); i < n; ++i) {
+    sentence(random, out, 5 + random.below(15));
+    out += ' ';
+    if (random.chance(10)) {
+      inline_tag(random, out);
+      out += ' ';
+    }
+  }
+  out += "\n\n";
+}
+
+static void chat(Random &random, std::string &out) {
+  for (usize i = 0, n = 1 + random.below(6); i < n; ++i) {
+    out += pick(random, WORDS);
+    out += ' ';
+    if (random.chance(60)) {
+      out += pick(random, CONSTANTS);
+      out += ' ';
+    }
+  }
+  out += pick(random, CONSTANTS);
+  out += '\n';
+}
+
+static void tags(Random &random, std::string &out) {
+  for (usize i = 0, n = 5 + random.below(10); i < n; ++i) {
+    inline_tag(random, out);
+    out += ' ';
+  }
+  out += '\n';
+}
+
+static void nested(Random &random, std::string &out, usize depth) {
+  out += random.chance(50) ? "[list]\n" : "[list=1]\n";
+  for (usize i = 0, n = 1 + random.below(4); i < n; ++i) {
+    out += "[*]";
+    if (depth > 0 && random.chance(60)) {
+      nested(random, out, depth - 1);
+    } else {
+      auto name = pick(random, INLINE);
+      out += '[';
+      out += name;
+      out += ']';
+      sentence(random, out, 3 + random.below(5));
+      out += "[/";
+      out += name;
+      out += "]\n";
+    }
+  }
+  out += "[/list]\n";
+}
+
+static void tables(Random &random, std::string &out) {
+  out += random.chance(30) ? "[table=aliceblue]\n" : "[table]\n";
+  for (usize row = 0, rows = 2 + random.below(6); row < rows; ++row) {
+    out += "[tr]";
+    for (usize col = 0; col < 4; ++col) {
+      out += "[td]";
+      out += pick(random, WORDS);
+      out += "[/td]";
+    }
+    out += "[/tr]\n";
+  }
+  out += "[/table]\n";
+}
+
+static void code(Random &random, std::string &out) {
+  out += "[code]\n";
+  for (usize i = 0, n = 50 + random.below(200); i < n; ++i) {
+    out += "    values[";
+    out += pick(random, WORDS);
+    out += "] = map[i] == 0 ? x[j] : y; // :)\n";
+  }
+  out += "[/code]\n";
+}
+
+static void garbage(Random &random, std::string &out) {
+  static const char CHARS[] = "[[]]]//==\n:)(-{}_1abcxyz ";
+  for (usize i = 0; i < 64; ++i) {
+    out += CHARS[random.below(sizeof(CHARS) - 1)];
+  }
+}
+
+static void append(Scenario scenario, Random &random, std::string &out) {
+  switch (scenario) {
+    case Prose:
+      prose(random, out);
+      break;
+    case Chat:
+      chat(random, out);
+      break;
+    case Tags:
+      tags(random, out);
+      break;
+    case Nested:
+      nested(random, out, 6);
+      break;
+    case Tables:
+      tables(random, out);
+      break;
+    case Code:
+      code(random, out);
+      break;
+    case Garbage:
+      garbage(random, out);
+      break;
+  }
+}
+
+std::string generate(Scenario scenario, usize bytes, u64 seed) {
+  Random random(seed);
+  std::string out;
+  out.reserve(bytes + 4096);
+  while (out.size() < bytes) {
+    append(scenario, random, out);
+  }
+  return out;
+}
+
+std::string generate_post(Random &random, usize bytes) {
+  auto scenario = Scenario(random.below(SCENARIO_COUNT));
+  std::string out;
+  do {
+    append(scenario, random, out);
+  } while (out.size() < bytes);
+  return out;
+}
+
+}
@@ -0,0 +1,59 @@
+#ifndef BBCODE_BENCH_CORPUS_H_
+#define BBCODE_BENCH_CORPUS_H_
+
+#include <string>
+#include <vector>
+
+#include "defs.h"
+
+namespace bbcode::bench {
+
+enum Scenario {
+  /// plain paragraphs, few tags
+  Prose = 0,
+
+  /// short lines dense with emoticons
+  Chat,
+
+  /// inline formatting on almost every word
+  Tags,
+
+  /// deeply nested lists and inline tags
+  Nested,
+
+  /// tables of short cells
+  Tables,
+
+  /// large [code] blocks containing brackets
+  Code,
+
+  /// random punctuation-heavy bytes
+  Garbage,
+};
+
+const usize SCENARIO_COUNT = Garbage + 1;
+
+const char *scenario_name(Scenario scenario);
+
+/// Deterministic splitmix64 generator, so the corpus is identical across
+/// platforms and standard libraries.
+class Random {
+ private:
+  u64 state;
+
+ public:
+  explicit Random(u64 seed) : state(seed) {}
+  u64 next();
+  usize below(usize n) { return usize(this->next() % n); }
+  bool chance(usize percent) { return this->below(100) < percent; }
+};
+
+/// Generate a document of about `bytes` bytes for scenario.
+std::string generate(Scenario scenario, usize bytes, u64 seed = 1);
+
+/// Generate a small forum post of random scenario.
+std::string generate_post(Random &random, usize bytes);
+
+}
+
+#endif //BBCODE_BENCH_CORPUS_H_
@@ -0,0 +1,99 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <string>
+#include <algorithm>
+
+#include "generator.h"
+#include "corpus.h"
+
+using namespace bbcode::lexer;
+using namespace bbcode::parser;
+using namespace bbcode::generator;
+using namespace bbcode::bench;
+
+static const usize DOCUMENT_SIZE = 1 << 20;
+static const usize REPEAT = 9;
+static const usize PREVIEW_NODES = 20;
+
+/// Best of a few runs, in MB/s.
+template<class F>
+static f64 measure(usize bytes, F f) {
+  f64 best = 0;
+  for (usize i = 0; i < REPEAT; ++i) {
+    auto begin = std::chrono::steady_clock::now();
+    f();
+    std::chrono::duration<f64> elapsed = std::chrono::steady_clock::now() - begin;
+    best = std::max(best, f64(bytes) / elapsed.count() / 1e6);
+  }
+  return best;
+}
+
+int main() {
+  std::cout << std::left << std::setw(10) << "scenario" << std::right
+            << std::setw(12) << "push tok" << std::setw(12) << "push view" << std::setw(12) << "pull tok"
+            << std::setw(12) << "push node" << std::setw(12) << "pull node"
+            << std::setw(14) << "preview x" << std::endl;
+
+  std::pmr::unsynchronized_pool_resource pool;
+  for (usize s = 0; s < SCENARIO_COUNT; ++s) {
+    auto scenario = Scenario(s);
+    auto text = generate(scenario, DOCUMENT_SIZE);
+    usize sink = 0;
+
+    auto push_tokens = measure(text.size(), [&]() {
+      Lexer lexer([&sink](LexItem &&item) {
+        sink += item.type;
+      }, &pool);
+      lexer.put(text);
+      lexer.finish();
+    });
+    // the lexer `tokens` runs, without the coroutine
+    auto push_views = measure(text.size(), [&]() {
+      ChunkLexer lexer([&sink](const LexView &item) {
+        sink += item.type;
+      });
+      lexer.put(text);
+      lexer.finish();
+    });
+    auto pull_tokens = measure(text.size(), [&]() {
+      for (auto &item : tokens(std::allocator_arg, &pool, text)) {
+        sink += item.type;
+      }
+    });
+
+    auto push_nodes = measure(text.size(), [&]() {
+      Parser parser([&sink](Node &&node) {
+        sink += node.span;
+      }, [](Message &&) {}, &pool);
+      Lexer lexer([&parser](LexItem &&item) {
+        parser.put(std::move(item));
+      }, &pool);
+      lexer.put(text);
+      lexer.finish();
+    });
+    auto pull_nodes = measure(text.size(), [&]() {
+      for (auto &node : nodes(std::allocator_arg, &pool, text)) {
+        sink += node.span;
+      }
+    });
+
+    // first nodes only, as for a preview, against the same by callback
+    auto preview = measure(text.size(), [&]() {
+      usize count = 0;
+      for (auto &node : nodes(std::allocator_arg, &pool, text)) {
+        sink += node.span;
+        if (++count == PREVIEW_NODES) {
+          break;
+        }
+      }
+    });
+
+    std::cout << std::left << std::setw(10) << scenario_name(scenario) << std::right << std::fixed
+              << std::setprecision(1) << std::setw(12) << push_tokens << std::setw(12) << push_views << std::setw(12) << pull_tokens
+              << std::setw(12) << push_nodes << std::setw(12) << pull_nodes
+              << std::setw(14) << preview / push_nodes << std::setw(0) << (sink ? "" : " ") << std::endl;
+  }
+
+  return 0;
+}
@@ -0,0 +1,101 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <string>
+
+#include "incremental.h"
+#include "corpus.h"
+
+using namespace bbcode::incremental;
+using namespace bbcode::bench;
+
+static const usize DOCUMENT_SIZE = 100 * 1024;
+static const usize KEYSTROKES = 400;
+// full parses are slow, so only every few keystrokes is compared
+static const usize FULL_EVERY = 20;
+
+static const char *TYPED[] = {
+    "the ", "patch ", "works ", "for ", "me ", ":) ", "[b]", "really", "[/b] ", "\n",
+};
+// without tags, so an edit never ripples past its line
+static const char *PLAIN[] = {
+    "the ", "patch ", "works ", "for ", "me ", ":) ", "really ",
+};
+
+template<class F>
+static f64 measure(F f) {
+  auto begin = std::chrono::steady_clock::now();
+  f();
+  auto elapsed = std::chrono::steady_clock::now() - begin;
+  return f64(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()) / 1e3;
+}
+
+struct Typing {
+  f64 incremental = 0;
+  f64 full = 0;
+  usize parsed = 0;
+};
+
+/// Type words at a few places, with some backspaces. Times in us per key.
+template<usize N>
+static Typing type(Document &document, Random &random, const char *const (&words)[N]) {
+  usize cursor = 0;
+  usize fulls = 0;
+  Typing typing;
+  std::string pending;
+  for (usize i = 0; i < KEYSTROKES; ++i) {
+    const auto &text = document.get_text();
+    if (i % 100 == 0) {
+      cursor = text.find('\n', random.below(text.size()));
+      cursor = cursor == std::string::npos ? text.size() : cursor + 1;
+    }
+
+    if (pending.empty()) {
+      pending = words[random.below(N)];
+    }
+
+    if (cursor > 0 && random.chance(10)) {
+      typing.incremental += measure([&]() { typing.parsed += document.edit(cursor - 1, 1, ""); });
+      --cursor;
+    } else {
+      auto c = pending.substr(0, 1);
+      pending.erase(0, 1);
+      typing.incremental += measure([&]() { typing.parsed += document.edit(cursor, 0, c); });
+      ++cursor;
+    }
+
+    if (i % FULL_EVERY == 0) {
+      typing.full += measure([&]() { Document(document.get_text()); });
+      ++fulls;
+    }
+  }
+
+  typing.incremental /= f64(KEYSTROKES);
+  typing.full /= f64(fulls);
+  return typing;
+}
+
+int main() {
+  std::cout << std::left << std::setw(10) << "scenario" << std::right << std::setw(14) << "full us/key"
+            << std::setw(14) << "incr us/key" << std::setw(14) << "parsed B/key"
+            << std::setw(14) << "text us/key" << std::setw(14) << "text B/key" << std::endl;
+
+  for (usize s = 0; s < SCENARIO_COUNT; ++s) {
+    auto scenario = Scenario(s);
+    Random random(s + 1);
+    auto text = generate(scenario, DOCUMENT_SIZE);
+    Document document(text);
+    auto tags = type(document, random, TYPED);
+    Document plain_document(text);
+    auto plain = type(plain_document, random, PLAIN);
+
+    std::cout << std::left << std::setw(10) << scenario_name(scenario) << std::right << std::fixed
+              << std::setprecision(1) << std::setw(14) << tags.full
+              << std::setw(14) << tags.incremental
+              << std::setw(14) << f64(tags.parsed) / f64(KEYSTROKES)
+              << std::setw(14) << plain.incremental
+              << std::setw(14) << f64(plain.parsed) / f64(KEYSTROKES) << std::endl;
+  }
+
+  return 0;
+}
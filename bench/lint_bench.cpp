@@ -0,0 +1,65 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstring>
+
+#include "lint.h"
+#include "engine.h"
+#include "corpus.h"
+
+using namespace bbcode::parser;
+using namespace bbcode::bench;
+
+template<class F>
+static f64 measure(F f) {
+  auto begin = std::chrono::steady_clock::now();
+  f();
+  std::chrono::duration<f64> elapsed = std::chrono::steady_clock::now() - begin;
+  return elapsed.count();
+}
+
+int main(int argc, char **argv) {
+  usize size = 8 << 20;
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+      size = std::strtoul(argv[++i], nullptr, 10);
+    } else {
+      std::cerr << "Usage: lint_bench [--size bytes]" << std::endl;
+      exit(1);
+    }
+  }
+
+  std::cout << std::left << std::setw(10) << "scenario" << std::right << std::setw(12) << "tree s"
+            << std::setw(12) << "lint s" << std::setw(10) << "speedup" << std::setw(10) << "messages"
+            << std::endl;
+
+  for (usize s = 0; s < SCENARIO_COUNT; ++s) {
+    auto scenario = Scenario(s);
+    auto text = generate(scenario, size);
+
+    // whole tree with messages, as a checker would do without lint
+    usize messages = 0;
+    auto tree = measure([&]() {
+      std::vector<Node> nodes;
+      bbcode::engine::Engine engine([&nodes](Node &&node) {
+        nodes.push_back(std::move(node));
+      }, [&messages](Message &&) {
+        ++messages;
+      });
+      engine.put(text);
+      engine.finish();
+    });
+
+    bbcode::lint::Result result;
+    auto lint = measure([&]() {
+      result = bbcode::lint::check(text);
+    });
+
+    std::cout << std::left << std::setw(10) << scenario_name(scenario) << std::right << std::fixed
+              << std::setprecision(3) << std::setw(12) << tree << std::setw(12) << lint
+              << std::setprecision(2) << std::setw(10) << tree / lint
+              << std::setw(10) << result.messages.size() << std::endl;
+  }
+
+  return 0;
+}
@@ -0,0 +1,70 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+#include "parallel.h"
+#include "corpus.h"
+
+using namespace bbcode::lexer;
+using namespace bbcode::parser;
+using namespace bbcode::bench;
+
+template<class F>
+static f64 measure(F f) {
+  auto begin = std::chrono::steady_clock::now();
+  f();
+  std::chrono::duration<f64> elapsed = std::chrono::steady_clock::now() - begin;
+  return elapsed.count();
+}
+
+int main(int argc, char **argv) {
+  usize size = 8 << 20;
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+      size = std::strtoul(argv[++i], nullptr, 10);
+    } else {
+      std::cerr << "Usage: parallel_bench [--size bytes]" << std::endl;
+      exit(1);
+    }
+  }
+
+  std::cout << std::thread::hardware_concurrency() << " hardware threads" << std::endl;
+  std::cout << std::left << std::setw(10) << "scenario" << std::right << std::setw(8) << "threads"
+            << std::setw(12) << "seconds" << std::setw(10) << "speedup" << std::setw(10) << "serial"
+            << std::setw(10) << "bound" << std::endl;
+
+  for (usize s = 0; s < SCENARIO_COUNT; ++s) {
+    auto scenario = Scenario(s);
+    auto text = generate(scenario, size);
+
+    // kept like `parallel::parse` does
+    std::vector<Node> nodes;
+    auto sequential = measure([&]() {
+      Parser parser([&nodes](Node &&node) { nodes.push_back(std::move(node)); }, [](Message &&) {});
+      Lexer lexer([&parser](LexItem &&item) {
+        parser.put(std::move(item));
+      });
+      lexer.put(text);
+      lexer.finish();
+    });
+
+    for (usize threads : {1, 8, 32}) {
+      bbcode::parallel::Result result;
+      auto seconds = measure([&]() {
+        result = bbcode::parallel::parse(text, threads, 64 << 10);
+      });
+
+      // speedup with `threads` cores if stitching were free
+      auto serial = f64(result.serial_bytes) / f64(text.size());
+      auto bound = 1 / ((1 - serial) / f64(threads) + serial);
+      std::cout << std::left << std::setw(10) << scenario_name(scenario) << std::right << std::fixed
+                << std::setw(8) << threads << std::setprecision(3) << std::setw(12) << seconds
+                << std::setprecision(2) << std::setw(10) << sequential / seconds
+                << std::setw(9) << serial * 100 << '%' << std::setw(10) << bound << std::endl;
+    }
+  }
+
+  return 0;
+}
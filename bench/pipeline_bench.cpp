@@ -0,0 +1,68 @@
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <chrono>
+#include <string>
+
+#include "pipeline.h"
+#include "writer.h"
+#include "corpus.h"
+
+using namespace bbcode::lexer;
+using namespace bbcode::parser;
+using namespace bbcode::pipeline;
+using namespace bbcode::bench;
+
+static const usize DOCUMENT_SIZE = 8 << 20;
+
+static f64 serial(const std::string &text) {
+  std::istringstream input(text);
+  std::ostringstream output;
+  auto begin = std::chrono::steady_clock::now();
+  bbcode::writer::HtmlWriter writer(&output);
+  Parser parser([](Node &&) {}, [](Message &&) {});
+  parser.set_events([&writer](const Event &event) {
+    writer(event);
+  });
+  ChunkLexer lexer([&parser](const LexView &item) {
+    parser.put(item);
+  });
+  std::string chunk(Options().chunk_size, '\0');
+  while (input) {
+    input.read(chunk.data(), isize(chunk.size()));
+    lexer.put(std::string_view(chunk.data(), usize(input.gcount())));
+  }
+  lexer.finish();
+  std::chrono::duration<f64> elapsed = std::chrono::steady_clock::now() - begin;
+  return elapsed.count();
+}
+
+int main() {
+  std::cout << std::left << std::setw(10) << "scenario" << std::right << std::setw(10) << "serial"
+            << std::setw(10) << "piped";
+  for (auto name : STAGE_NAMES) {
+    std::cout << std::setw(8) << name;
+  }
+  std::cout << std::endl;
+
+  for (usize s = 0; s < SCENARIO_COUNT; ++s) {
+    auto scenario = Scenario(s);
+    auto text = generate(scenario, DOCUMENT_SIZE);
+
+    auto alone = serial(text);
+    std::istringstream input(text);
+    std::ostringstream output;
+    auto result = render_html(&input, &output);
+
+    // utilization: share of the wall time each stage was busy
+    std::cout << std::left << std::setw(10) << scenario_name(scenario) << std::right << std::fixed
+              << std::setprecision(1) << std::setw(10) << f64(text.size()) / alone / 1e6
+              << std::setw(10) << f64(text.size()) / result.seconds / 1e6;
+    for (const auto &stage : result.stages) {
+      std::cout << std::setw(7) << stage.busy / result.seconds * 100 << '%';
+    }
+    std::cout << std::endl;
+  }
+
+  return 0;
+}
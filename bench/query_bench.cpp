@@ -0,0 +1,92 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstring>
+
+#include "engine.h"
+#include "corpus.h"
+
+using namespace bbcode::parser;
+using namespace bbcode::bench;
+
+template<class F>
+static f64 measure(F f) {
+  auto begin = std::chrono::steady_clock::now();
+  f();
+  std::chrono::duration<f64> elapsed = std::chrono::steady_clock::now() - begin;
+  return elapsed.count();
+}
+
+static void walk(const Node &node, std::vector<std::string_view> *links) {
+  for (const auto &child : node.children) {
+    walk(child, links);
+  }
+  if (node.type == bbcode::grammar::Parametric && node.name == "url") {
+    links->push_back(node.data);
+  }
+}
+
+int main(int argc, char **argv) {
+  usize size = 8 << 20;
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+      size = std::strtoul(argv[++i], nullptr, 10);
+    } else {
+      std::cerr << "Usage: query_bench [--size bytes]" << std::endl;
+      exit(1);
+    }
+  }
+
+  std::cout << std::left << std::setw(10) << "scenario" << std::right << std::setw(12) << "parse s"
+            << std::setw(12) << "indexed s" << std::setw(12) << "walk ms" << std::setw(12) << "scan ms"
+            << std::setw(10) << "links" << std::endl;
+
+  for (usize s = 0; s < SCENARIO_COUNT; ++s) {
+    auto scenario = Scenario(s);
+    auto text = generate(scenario, size);
+
+    std::vector<Node> nodes;
+    auto parse = measure([&]() {
+      bbcode::engine::Engine engine([&nodes](Node &&node) {
+        nodes.push_back(std::move(node));
+      }, [](Message &&) {});
+      engine.put(text);
+      engine.finish();
+    });
+
+    std::vector<Node> indexed_nodes;
+    bbcode::query::Index index;
+    auto indexed = measure([&]() {
+      bbcode::engine::Engine engine([&indexed_nodes](Node &&node) {
+        indexed_nodes.push_back(std::move(node));
+      }, [](Message &&) {});
+      engine.set_index(&index);
+      engine.put(text);
+      engine.finish();
+    });
+
+    std::vector<std::string_view> walked;
+    auto walk_time = measure([&]() {
+      for (const auto &node : nodes) {
+        walk(node, &walked);
+      }
+    });
+
+    std::vector<std::string_view> scanned;
+    auto scan_time = measure([&]() {
+      scanned = index.parameters("url");
+    });
+
+    if (walked != scanned) {
+      std::cerr << "Index differs from tree in " << scenario_name(scenario) << std::endl;
+      return 1;
+    }
+
+    std::cout << std::left << std::setw(10) << scenario_name(scenario) << std::right << std::fixed
+              << std::setprecision(3) << std::setw(12) << parse << std::setw(12) << indexed
+              << std::setw(12) << walk_time * 1000 << std::setw(12) << scan_time * 1000
+              << std::setw(10) << scanned.size() << std::endl;
+  }
+
+  return 0;
+}
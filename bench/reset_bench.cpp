@@ -0,0 +1,68 @@
+#include <iostream>
+#include <chrono>
+#include <vector>
+#include <string>
+
+#include "parser.h"
+
+using namespace bbcode::lexer;
+using namespace bbcode::parser;
+
+static const std::vector<std::string> POSTS = {
+    "+1",
+    "thanks :)",
+    "[b]agreed[/b]",
+    "[quote]nope[/quote] :(",
+    "see [url=http://example.com]here[/url]",
+    "[color=red]warning[/color]\nread the rules",
+};
+
+static const usize ROUNDS = 200000;
+
+template<class F>
+static f64 measure(F f) {
+  auto begin = std::chrono::steady_clock::now();
+  f();
+  auto elapsed = std::chrono::steady_clock::now() - begin;
+  return f64(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()) /
+      f64(ROUNDS * POSTS.size());
+}
+
+int main() {
+  usize nodes = 0;
+
+  auto fresh = measure([&]() {
+    for (usize i = 0; i < ROUNDS; ++i) {
+      for (const auto &post : POSTS) {
+        Parser parser([&nodes](Node &&) { ++nodes; }, [](Message &&) {});
+        Lexer lexer([&parser](LexItem &&item) {
+          parser.put(std::move(item));
+        });
+        lexer.put(post);
+        lexer.finish();
+      }
+    }
+  });
+
+  Parser parser([&nodes](Node &&) { ++nodes; }, [](Message &&) {});
+  Lexer lexer([&parser](LexItem &&item) {
+    parser.put(std::move(item));
+  });
+
+  auto reused = measure([&]() {
+    for (usize i = 0; i < ROUNDS; ++i) {
+      for (const auto &post : POSTS) {
+        parser.reset();
+        lexer.reset();
+        lexer.put(post);
+        lexer.finish();
+      }
+    }
+  });
+
+  std::cout << "fresh:  " << fresh << " ns/post" << std::endl;
+  std::cout << "reused: " << reused << " ns/post" << std::endl;
+  std::cout << "(" << nodes << " nodes)" << std::endl;
+
+  return 0;
+}
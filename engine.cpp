@@ -0,0 +1,224 @@
+#include "engine.h"
+#include <array>
+#include <cassert>
+
+namespace bbcode::engine {
+
+namespace {
+
+enum CharClass : u8 {
+  Text,
+  /// "["
+  Bracket,
+  /// "]"
+  RightBracket,
+  /// "="
+  EqualSign,
+  /// "\n"
+  Linefeed,
+  CLASS_COUNT,
+};
+
+enum Action : u8 {
+  /// add to pending text and walk the constant trie
+  Append,
+  /// add to pending text, constants can't span it
+  AppendBreak,
+  /// flush pending text, next byte tells "[" from "[/"
+  Open,
+  /// flush pending text and put the byte as its own item
+  Dispatch,
+  /// parser is done, ignore the rest of the input
+  Stop,
+};
+
+constexpr auto CLASSES = [] {
+  std::array<CharClass, 256> classes {};
+  classes[u8('[')] = Bracket;
+  classes[u8(']')] = RightBracket;
+  classes[u8('=')] = EqualSign;
+  classes[u8('\n')] = Linefeed;
+  return classes;
+}();
+
+constexpr LexType ITEMS[CLASS_COUNT] = {
+    Literal,
+    OpenTagLeft,
+    TagRight,
+    Equal,
+    Newline,
+};
+
+using Transitions = std::array<std::array<Action, CLASS_COUNT>, parser::Done + 1>;
+
+/// With `fuse`, "]" and "=" stay in pending text in the states where the
+/// parser appends them as text anyway. Without it every tag character is
+/// its own item, so the literal limit cuts at the same place as `Lexer`.
+///
+/// Pending text never changes the state it is looked up in: text keeps
+/// Literal, Verbatim and Parameter, and moves TagOpen and TagClose to
+/// their Known states, which dispatch the same bytes.
+constexpr Transitions generate(bool fuse) {
+  Transitions table {};
+  for (auto &row : table) {
+    row[Text] = Append;
+    row[Bracket] = Open;
+    row[RightBracket] = Dispatch;
+    row[EqualSign] = Dispatch;
+    row[Linefeed] = Dispatch;
+  }
+  table[parser::Done].fill(Stop);
+
+  if (fuse) {
+    for (auto state : {parser::Literal, parser::Verbatim}) {
+      table[state][RightBracket] = AppendBreak;
+      table[state][EqualSign] = AppendBreak;
+    }
+    table[parser::Parameter][EqualSign] = AppendBreak;
+  }
+
+  return table;
+}
+
+constexpr Transitions FUSED = generate(true);
+constexpr Transitions SPLIT = generate(false);
+
+}
+
+Engine::Engine(std::function<void(parser::Node &&)> callback, MessageEmitter emitter,
+               std::pmr::memory_resource *resource)
+    : parser(std::move(callback), std::move(emitter), resource),
+      cursor(Trie::get_cursor()),
+      fuse(true),
+      left_tag(false),
+      line(0),
+      chr(0),
+      offset(0) {}
+
+void Engine::send_buffer(LexType type) {
+  if (!this->buffer.empty()) {
+    auto size = this->buffer.size();
+    // same positions as `Lexer`
+    auto back = type == Literal ? size + 1 : size;
+    this->parser.put(LexView {
+        .type = type,
+        .line = this->line,
+        .chr = this->chr - back,
+        .offset = this->offset - back,
+        .content = this->buffer,
+    });
+    this->buffer.clear();
+  }
+}
+
+void Engine::put(std::string_view s) {
+  const auto &table = this->fuse ? FUSED : SPLIT;
+
+  for (const auto &c : s) {
+    ++this->chr;
+    ++this->offset;
+
+    if (this->left_tag) {
+      this->left_tag = false;
+      if (c == '/') {
+        this->dispatch(CloseTagLeft, 2);
+        continue;
+      }
+      this->dispatch(OpenTagLeft, 2);
+    }
+
+    auto type = CLASSES[u8(c)];
+    switch (table[this->parser.current_state()][type]) {
+      case Append: {
+        this->buffer += c;
+        auto[result, valid] = this->cursor.walk(static_cast<i8>(c));
+        assert(valid);
+        if (result == trie::NotFound) {
+          this->cursor.reset();
+        }
+        else if (result == trie::Found) {
+          std::size_t curr = this->cursor.step();
+          std::size_t extra = this->buffer.size() - curr;
+          if (extra > 0) {
+            const auto text = std::string_view(this->buffer);
+            this->parser.put(LexView {
+                .type = Literal,
+                .line = this->line,
+                .chr = this->chr - text.size(),
+                .offset = this->offset - text.size(),
+                .content = text.substr(0, extra),
+            });
+            this->parser.put(LexView {
+                .type = Constant,
+                .line = this->line,
+                .chr = this->chr - curr,
+                .offset = this->offset - curr,
+                .content = text.substr(extra),
+            });
+            this->buffer.clear();
+          }
+          else {
+            this->send_buffer(Constant);
+          }
+
+          this->cursor.reset();
+        }
+        break;
+      }
+      case AppendBreak:
+        this->buffer += c;
+        this->cursor.reset();
+        break;
+      case Open:
+        this->send_buffer(Literal);
+        this->cursor.reset();
+        this->left_tag = true;
+        break;
+      case Dispatch:
+        this->send_buffer(Literal);
+        this->cursor.reset();
+        this->dispatch(ITEMS[type], 1);
+        if (type == Linefeed) {
+          ++this->line;
+          this->chr = 0;
+        }
+        break;
+      case Stop:
+        return;
+    }
+  }
+}
+
+void Engine::finish() {
+  // pending text ends as if at one more byte, as in `Lexer`
+  ++this->chr;
+  ++this->offset;
+  this->send_buffer(Literal);
+  this->dispatch(End, 1);
+}
+
+void Engine::set_limits(const parser::ParseLimits &l) {
+  this->parser.set_limits(l);
+  this->fuse = l.max_literal_bytes == 0;
+}
+
+void Engine::rewind() {
+  this->buffer.clear();
+  this->cursor.reset();
+  this->left_tag = false;
+  this->line = 0;
+  this->chr = 0;
+  this->offset = 0;
+}
+
+void Engine::reset() {
+  this->parser.reset();
+  this->rewind();
+}
+
+void Engine::reset(std::pmr::memory_resource *resource) {
+  this->parser.reset(resource);
+  this->rewind();
+}
+
+}
@@ -0,0 +1,80 @@
+#ifndef BBCODE__ENGINE_H_
+#define BBCODE__ENGINE_H_
+
+#include <string>
+#include <string_view>
+
+#include "parser.h"
+
+namespace bbcode::engine {
+
+using namespace bbcode::lexer;
+
+/// Lexer and parser in one pass.
+///
+/// Bytes are classified and looked up in a (ParserState, byte class) table
+/// instead of being turned into `LexItem`s. "]" and "=" that the parser
+/// would only append as text stay in the pending text, and text is handed
+/// to the parser as a view of the pending buffer. Trees and messages are
+/// the same as with `Lexer` feeding `Parser`.
+///
+/// Parser stats are collected, lexer stats are not.
+class Engine {
+ private:
+  parser::Parser parser;
+  std::string buffer;
+  bbcode::TrieCursor cursor;
+  bool fuse;
+  bool left_tag;
+  usize line;
+  usize chr;
+  usize offset;
+
+ private:
+  void rewind();
+  void send_buffer(LexType type);
+  void dispatch(LexType type, usize back) {
+    this->parser.put(LexView {
+        .type = type,
+        .line = this->line,
+        .chr = this->chr - back,
+        .offset = this->offset - back,
+    });
+  }
+ public:
+  /// Nodes are allocated from `resource`, see `Parser`.
+  Engine(std::function<void(parser::Node &&)> callback, MessageEmitter emitter,
+         std::pmr::memory_resource *resource = std::pmr::get_default_resource());
+  void put(std::string_view s);
+  void finish();
+  /// Attach stats to fill. No-op unless built with `BBCODE_STATS`.
+  void set_stats(ParseStats *s) {
+    this->parser.set_stats(s);
+  }
+  /// See `Parser::set_severities`.
+  void set_severities(SeverityMask mask) {
+    this->parser.set_severities(mask);
+  }
+  /// See `Parser::set_diagnostics`.
+  void set_diagnostics(DiagnosticHandler handler) {
+    this->parser.set_diagnostics(std::move(handler));
+  }
+  /// See `Parser::set_index`.
+  void set_index(query::Index *index) {
+    this->parser.set_index(index);
+  }
+  /// See `Parser::set_lint`.
+  void set_lint(bool on) {
+    this->parser.set_lint(on);
+  }
+  /// See `Parser::set_limits`.
+  void set_limits(const parser::ParseLimits &l);
+  /// Return to initial state for a new document. Callbacks and limits are kept.
+  void reset();
+  /// Like `reset`, and allocate nodes of the next document from `resource`.
+  void reset(std::pmr::memory_resource *resource);
+};
+
+}
+
+#endif //BBCODE__ENGINE_H_
@@ -0,0 +1,119 @@
+#include "cost.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstddef>
+#include <new>
+#include <string>
+
+#include "parser.h"
+
+static usize allocations = 0;
+
+// std::pmr::new_delete_resource() uses the aligned forms, count them too.
+void *operator new(std::size_t size, std::align_val_t align) {
+  ++allocations;
+  auto alignment = std::max(std::size_t(align), sizeof(void *));
+  if (void *p = std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void *operator new(std::size_t size) {
+  return operator new(size, std::align_val_t(alignof(std::max_align_t)));
+}
+
+void operator delete(void *p) noexcept {
+  std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept {
+  std::free(p);
+}
+
+void operator delete(void *p, std::align_val_t) noexcept {
+  std::free(p);
+}
+
+void operator delete(void *p, std::size_t, std::align_val_t) noexcept {
+  std::free(p);
+}
+
+namespace bbcode::fuzz {
+
+using namespace bbcode::lexer;
+using namespace bbcode::parser;
+
+static f64 env_rate(const char *name, f64 fallback) {
+  auto value = std::getenv(name);
+  if (value == nullptr) {
+    return fallback;
+  }
+
+  char *end;
+  auto rate = std::strtod(value, &end);
+  return end != value && rate >= 0 ? rate : fallback;
+}
+
+Budget Budget::from_env() {
+  Budget budget;
+  budget.ns_per_byte = env_rate("BBCODE_FUZZ_NS_PER_BYTE", budget.ns_per_byte);
+  budget.allocations_per_byte = env_rate("BBCODE_FUZZ_ALLOCS_PER_BYTE", budget.allocations_per_byte);
+  return budget;
+}
+
+f64 Budget::score(const Cost &cost) const {
+  f64 score = 0;
+  if (this->ns_per_byte > 0) {
+    score = std::max(score, f64(cost.ns) / (f64(this->base_ns) + this->ns_per_byte * f64(cost.bytes)));
+  }
+  if (this->allocations_per_byte > 0) {
+    score = std::max(score, f64(cost.allocations) /
+        (f64(this->base_allocations) + this->allocations_per_byte * f64(cost.bytes)));
+  }
+  return score;
+}
+
+usize allocation_count() {
+  return allocations;
+}
+
+Cost measure(std::string_view input) {
+  static usize nodes = 0;
+  static Parser parser([](Node &&node) {
+    nodes += node.children.size();
+  }, [](Message &&) {});
+  static Lexer lexer([](LexItem &&item) {
+    parser.put(std::move(item));
+  });
+
+  Cost cost {
+      .bytes = input.size(),
+      .ns = ~u64(0),
+  };
+
+  for (usize run = 0; run < 2; ++run) {
+    auto before = allocations;
+    auto begin = std::chrono::steady_clock::now();
+    parser.reset();
+    lexer.reset();
+    lexer.put(input);
+    lexer.finish();
+    auto elapsed = std::chrono::steady_clock::now() - begin;
+
+    cost.ns = std::min(cost.ns, u64(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+    cost.allocations = allocations - before;
+  }
+
+  return cost;
+}
+
+void write_cost(const Cost &cost, std::ostream *o) {
+  auto bytes = f64(std::max<usize>(cost.bytes, 1));
+  *o << cost.bytes << " bytes, " << f64(cost.ns) / bytes << " ns/byte, "
+     << f64(cost.allocations) / bytes << " allocations/byte";
+}
+
+}
@@ -0,0 +1,46 @@
+#ifndef BBCODE_FUZZ_COST_H_
+#define BBCODE_FUZZ_COST_H_
+
+#include <string_view>
+#include <ostream>
+
+#include "defs.h"
+
+namespace bbcode::fuzz {
+
+/// Cost of parsing one input.
+struct Cost {
+  usize bytes;
+  u64 ns;
+  usize allocations;
+};
+
+/// Cost allowed for an input: a constant part plus a part linear in size.
+/// A zero per byte rate disables that check.
+struct Budget {
+  f64 ns_per_byte = 2000;
+  f64 allocations_per_byte = 4;
+  u64 base_ns = 200000;
+  usize base_allocations = 256;
+
+  /// Budget with rates overridden by `BBCODE_FUZZ_NS_PER_BYTE` and
+  /// `BBCODE_FUZZ_ALLOCS_PER_BYTE` environment variables.
+  static Budget from_env();
+
+  /// Ratio of cost to budget, whichever is worse. Above 1 is over budget.
+  f64 score(const Cost &cost) const;
+  bool exceeded(const Cost &cost) const { return this->score(cost) > 1; }
+};
+
+/// Heap allocations made by the process so far.
+usize allocation_count();
+
+/// Feed input through a `Lexer` and `Parser` reused across calls, twice,
+/// and report the faster time and the allocations of the warm run.
+Cost measure(std::string_view input);
+
+void write_cost(const Cost &cost, std::ostream *o);
+
+}
+
+#endif //BBCODE_FUZZ_COST_H_
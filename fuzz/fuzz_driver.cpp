@@ -0,0 +1,263 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <optional>
+
+#include "cost.h"
+#include "grammar.h"
+#include "bench/corpus.h"
+
+using namespace bbcode::fuzz;
+using namespace bbcode::bench;
+
+struct Entry {
+  std::string input;
+  Cost cost;
+  f64 score;
+};
+
+class Fuzzer {
+ private:
+  Budget budget;
+  Random random;
+  usize max_len;
+  std::vector<std::string> dictionary;
+
+  // inputs with highest cost relative to budget, worst first
+  std::vector<Entry> pool;
+
+  static const usize POOL_SIZE = 256;
+
+  void mutate(std::string &input) {
+    auto at = input.empty() ? 0 : this->random.below(input.size() + 1);
+    switch (this->random.below(6)) {
+      case 0: {
+        input.insert(at, this->dictionary[this->random.below(this->dictionary.size())]);
+        break;
+      }
+      case 1: {
+        input.insert(input.begin() + isize(at), char(this->random.below(128)));
+        break;
+      }
+      case 2: {
+        if (at < input.size()) {
+          input.erase(at, 1 + this->random.below(std::min<usize>(input.size() - at, 64)));
+        }
+        break;
+      }
+      case 3: {
+        // repeating a slice is what turns a slow pattern into a slow input
+        if (at < input.size()) {
+          auto slice = input.substr(at, 1 + this->random.below(std::min<usize>(input.size() - at, 32)));
+          auto times = 1 + this->random.below(256);
+          std::string repeated;
+          for (usize i = 0; i < times; ++i) {
+            repeated += slice;
+          }
+          input.insert(at, repeated);
+        }
+        break;
+      }
+      case 4: {
+        const auto &other = this->pool[this->random.below(this->pool.size())].input;
+        if (!other.empty()) {
+          auto from = this->random.below(other.size());
+          input.insert(at, other, from, 1 + this->random.below(other.size() - from));
+        }
+        break;
+      }
+      default: {
+        if (at < input.size()) {
+          input[at] = char(this->random.below(128));
+        }
+        break;
+      }
+    }
+
+    if (input.size() > this->max_len) {
+      input.resize(this->max_len);
+    }
+  }
+
+  void keep(std::string &&input, const Cost &cost, f64 score) {
+    if (this->pool.size() >= POOL_SIZE) {
+      if (score <= this->pool.back().score) {
+        return;
+      }
+      this->pool.pop_back();
+    }
+
+    auto it = std::upper_bound(this->pool.begin(), this->pool.end(), score, [](f64 s, const Entry &e) {
+      return s > e.score;
+    });
+    this->pool.insert(it, Entry {std::move(input), cost, score});
+  }
+
+ public:
+  Fuzzer(const Budget &budget, u64 seed, usize max_len)
+      : budget(budget), random(seed), max_len(max_len) {
+    this->dictionary = {"[", "[/", "]", "=", "\n", "[*]", "[/*]"};
+    for (const auto &[name, descriptor] : bbcode::grammar::NODE_MAP) {
+      this->dictionary.push_back("[" + name + "]");
+      this->dictionary.push_back("[/" + name + "]");
+      this->dictionary.push_back("[" + name + "=");
+    }
+    for (const auto &constant : bbcode::grammar::CONSTANTS) {
+      this->dictionary.emplace_back(constant);
+    }
+
+    for (usize i = 0; i < POOL_SIZE; ++i) {
+      auto post = generate_post(this->random, 64 + this->random.below(1024));
+      auto cost = measure(post);
+      this->keep(std::move(post), cost, this->budget.score(cost));
+    }
+  }
+
+  /// Run one mutated input. Returns it if it is over budget.
+  std::optional<std::pair<std::string, Cost>> step() {
+    // favour the worst inputs found so far
+    auto pick = this->random.below(this->pool.size());
+    pick = pick * pick / this->pool.size();
+    auto input = this->pool[pick].input;
+
+    auto mutations = 1 + this->random.below(4);
+    for (usize i = 0; i < mutations; ++i) {
+      this->mutate(input);
+    }
+
+    auto cost = measure(input);
+    auto score = this->budget.score(cost);
+    if (score > 1) {
+      // confirm, timing of a single run may be noise
+      cost = measure(input);
+      score = this->budget.score(cost);
+      if (score > 1) {
+        return std::make_pair(std::move(input), cost);
+      }
+    }
+
+    this->keep(std::move(input), cost, score);
+    return std::nullopt;
+  }
+
+  [[nodiscard]] const Entry &worst() const {
+    return this->pool.front();
+  }
+};
+
+static bool read_file(const std::string &path, std::string &out) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open()) {
+    return false;
+  }
+
+  std::stringstream ss;
+  ss << file.rdbuf();
+  out = ss.str();
+  return true;
+}
+
+static std::string input_name(const std::string &input) {
+  // FNV-1a, stable name for an input
+  u64 hash = 0xcbf29ce484222325;
+  for (auto c : input) {
+    hash = (hash ^ u8(c)) * 0x100000001b3;
+  }
+  std::stringstream ss;
+  ss << "slow-" << std::hex << std::setw(16) << std::setfill('0') << hash;
+  return ss.str();
+}
+
+static void usage() {
+  std::cerr << "Usage: fuzz_driver [--runs n] [--max-len bytes] [--seed n] [--ns-per-byte x]\n"
+               "                   [--allocs-per-byte x] [--output dir] [input_file...]\n"
+               "Without input files, mutate generated posts looking for inputs whose cost\n"
+               "exceeds the linear budget and save them to output dir. With input files,\n"
+               "measure each and fail if any is over budget." << std::endl;
+}
+
+int main(int argc, char **argv) {
+  auto budget = Budget::from_env();
+  usize runs = 100000;
+  usize max_len = 64 * 1024;
+  u64 seed = 1;
+  std::string output = ".";
+  std::vector<std::string> files;
+
+  for (int i = 1; i < argc; ++i) {
+    auto arg = std::string_view(argv[i]);
+    if (arg.starts_with("--") && i + 1 >= argc) {
+      usage();
+      return 1;
+    }
+
+    if (arg == "--runs") {
+      runs = std::stoull(argv[++i]);
+    } else if (arg == "--max-len") {
+      max_len = std::stoull(argv[++i]);
+    } else if (arg == "--seed") {
+      seed = std::stoull(argv[++i]);
+    } else if (arg == "--ns-per-byte") {
+      budget.ns_per_byte = std::stod(argv[++i]);
+    } else if (arg == "--allocs-per-byte") {
+      budget.allocations_per_byte = std::stod(argv[++i]);
+    } else if (arg == "--output") {
+      output = argv[++i];
+    } else if (arg.starts_with("--")) {
+      usage();
+      return 1;
+    } else {
+      files.emplace_back(arg);
+    }
+  }
+
+  if (!files.empty()) {
+    bool slow = false;
+    for (const auto &path : files) {
+      std::string input;
+      if (!read_file(path, input)) {
+        std::cerr << "Failed opening file: " << path << " for read." << std::endl;
+        return 1;
+      }
+
+      auto cost = measure(input);
+      std::cout << path << ": ";
+      write_cost(cost, &std::cout);
+      if (budget.exceeded(cost)) {
+        std::cout << " [over budget]";
+        slow = true;
+      }
+      std::cout << std::endl;
+    }
+
+    return slow ? 1 : 0;
+  }
+
+  Fuzzer fuzzer(budget, seed, max_len);
+  usize found = 0;
+  for (usize run = 1; run <= runs; ++run) {
+    if (auto result = fuzzer.step()) {
+      auto &[input, cost] = *result;
+      auto path = output + "/" + input_name(input);
+      std::ofstream file(path, std::ios::binary | std::ios::trunc);
+      file.write(input.data(), isize(input.size()));
+      std::cout << "Over budget: ";
+      write_cost(cost, &std::cout);
+      std::cout << ", saved to " << path << std::endl;
+      ++found;
+    }
+
+    if (run % 500 == 0) {
+      std::cout << "#" << run << " worst " << std::setprecision(3) << fuzzer.worst().score << " of budget: ";
+      write_cost(fuzzer.worst().cost, &std::cout);
+      std::cout << std::endl;
+    }
+  }
+
+  std::cout << found << " input" << (found == 1 ? "" : "s") << " over budget." << std::endl;
+  return found ? 1 : 0;
+}
@@ -0,0 +1,22 @@
+#include <iostream>
+#include <cstdlib>
+
+#include "cost.h"
+
+using namespace bbcode::fuzz;
+
+/// libFuzzer entry. Inputs over the linear budget abort, so libFuzzer
+/// saves them as crash files.
+extern "C" int LLVMFuzzerTestOneInput(const u8 *data, usize size) {
+  static const Budget budget = Budget::from_env();
+
+  auto cost = measure(std::string_view(reinterpret_cast<const char *>(data), size));
+  if (budget.exceeded(cost)) {
+    std::cerr << "Input over budget: ";
+    write_cost(cost, &std::cerr);
+    std::cerr << std::endl;
+    std::abort();
+  }
+
+  return 0;
+}
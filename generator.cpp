@@ -0,0 +1,103 @@
+#include "generator.h"
+
+#include <vector>
+#include <deque>
+#include <functional>
+
+namespace bbcode::generator {
+
+using namespace bbcode::lexer;
+using namespace bbcode::parser;
+
+static usize tail(usize size) {
+  auto align = alignof(std::pmr::memory_resource *);
+  return (size + align - 1) / align * align;
+}
+
+void *FrameAllocator::allocate(usize size, std::pmr::memory_resource *resource) {
+  auto *frame = static_cast<char *>(resource->allocate(tail(size) + sizeof(resource)));
+  new(frame + tail(size)) std::pmr::memory_resource *(resource);
+  return frame;
+}
+
+void FrameAllocator::deallocate(void *frame, usize size) {
+  auto *resource = *reinterpret_cast<std::pmr::memory_resource **>(static_cast<char *>(frame) + tail(size));
+  resource->deallocate(frame, tail(size) + sizeof(resource));
+}
+
+// The lexer and parser push into `pending`, which is yielded from after each
+// block of input. Stopping early wastes at most one block of work.
+static const usize BLOCK = 64;
+// Lexing is cheap next to parsing, and each block end costs the lexer a
+// carried token, so tokens are lexed in larger blocks.
+static const usize TOKEN_BLOCK = 1024;
+
+// GCC pairs the frame's placement new with its plain delete at the end of
+// each coroutine, which is how coroutine frames are freed.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+Generator<LexView> tokens(std::allocator_arg_t, std::pmr::memory_resource *resource,
+                          std::string_view text) {
+  std::pmr::vector<LexView> pending(resource);
+  // text carried across a block end lives in the lexer's buffer, which the
+  // next block overwrites, so only that is copied
+  std::pmr::deque<std::pmr::string> carried(resource);
+  ChunkLexer lexer([&pending, &carried, text](const LexView &view) {
+    auto &item = pending.emplace_back(view);
+    auto *data = view.content.data();
+    if (!view.content.empty() &&
+        (std::less<const char *>()(data, text.data()) ||
+         !std::less<const char *>()(data, text.data() + text.size()))) {
+      item.content = carried.emplace_back(view.content);
+    }
+  });
+
+  for (usize i = 0; i < text.size(); i += TOKEN_BLOCK) {
+    lexer.put(text.substr(i, TOKEN_BLOCK));
+    for (auto &item : pending) {
+      co_yield item;
+    }
+    pending.clear();
+    carried.clear();
+  }
+
+  lexer.finish();
+  for (auto &item : pending) {
+    co_yield item;
+  }
+}
+
+Generator<Node> nodes(std::allocator_arg_t, std::pmr::memory_resource *resource,
+                      std::string_view text, MessageEmitter emitter) {
+  std::pmr::vector<Node> pending(resource);
+  Parser parser([&pending](Node &&node) {
+    if (node.type != grammar::End) {
+      pending.push_back(std::move(node));
+    }
+  }, std::move(emitter), resource);
+  Lexer lexer([&parser](LexItem &&item) {
+    parser.put(std::move(item));
+  }, resource);
+
+  for (usize i = 0; i < text.size(); i += BLOCK) {
+    lexer.put(text.substr(i, BLOCK));
+    for (auto &node : pending) {
+      co_yield node;
+    }
+    pending.clear();
+  }
+
+  lexer.finish();
+  for (auto &node : pending) {
+    co_yield node;
+  }
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+}
@@ -0,0 +1,168 @@
+#ifndef BBCODE__GENERATOR_H_
+#define BBCODE__GENERATOR_H_
+
+#include <coroutine>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <memory_resource>
+#include <string_view>
+#include <utility>
+
+#include "parser.h"
+
+namespace bbcode::generator {
+
+using bbcode::lexer::LexView;
+using bbcode::parser::Node;
+
+/// Coroutine frame allocation. The frame comes from the resource passed
+/// after `std::allocator_arg`, or the default resource if there is none,
+/// and the resource is stored behind the frame to free it.
+struct FrameAllocator {
+  static void *allocate(usize size, std::pmr::memory_resource *resource);
+  static void deallocate(void *frame, usize size);
+};
+
+/// Lazily produced sequence of `T`, pulled with range-for. Nothing runs
+/// until the first value is asked for, and the coroutine suspends after
+/// each value. Destroying the generator abandons the rest of the work.
+///
+/// Values are yielded by reference and may be moved from. A reference is
+/// only valid until the iterator is advanced.
+template<class T>
+class Generator {
+ public:
+  struct promise_type {
+    T *current = nullptr;
+    std::exception_ptr exception;
+
+    Generator get_return_object() {
+      return Generator(std::coroutine_handle<promise_type>::from_promise(*this));
+    }
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    std::suspend_always final_suspend() noexcept { return {}; }
+    std::suspend_always yield_value(T &value) noexcept {
+      this->current = std::addressof(value);
+      return {};
+    }
+    // a temporary lives until the coroutine resumes
+    std::suspend_always yield_value(T &&value) noexcept {
+      this->current = std::addressof(value);
+      return {};
+    }
+    void return_void() noexcept {}
+    void unhandled_exception() {
+      this->exception = std::current_exception();
+    }
+
+    static void *operator new(usize size) {
+      return FrameAllocator::allocate(size, std::pmr::get_default_resource());
+    }
+    template<class... Args>
+    static void *operator new(usize size, std::allocator_arg_t, std::pmr::memory_resource *resource,
+                              const Args &...) {
+      return FrameAllocator::allocate(size, resource);
+    }
+    static void operator delete(void *frame, usize size) {
+      FrameAllocator::deallocate(frame, size);
+    }
+  };
+
+  class Iterator {
+   private:
+    std::coroutine_handle<promise_type> handle;
+
+   public:
+    using iterator_category = std::input_iterator_tag;
+    using difference_type = std::ptrdiff_t;
+    using value_type = T;
+
+    Iterator() = default;
+    explicit Iterator(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+    T &operator*() const {
+      return *this->handle.promise().current;
+    }
+    T *operator->() const {
+      return this->handle.promise().current;
+    }
+    Iterator &operator++() {
+      this->handle.resume();
+      if (this->handle.promise().exception) {
+        std::rethrow_exception(this->handle.promise().exception);
+      }
+      return *this;
+    }
+    void operator++(int) {
+      ++*this;
+    }
+    bool operator==(std::default_sentinel_t) const {
+      return !this->handle || this->handle.done();
+    }
+  };
+
+ private:
+  std::coroutine_handle<promise_type> handle;
+
+  explicit Generator(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+
+ public:
+  Generator(Generator &&other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+  Generator &operator=(Generator &&other) noexcept {
+    if (this != &other) {
+      if (this->handle) {
+        this->handle.destroy();
+      }
+      this->handle = std::exchange(other.handle, nullptr);
+    }
+    return *this;
+  }
+  Generator(const Generator &) = delete;
+  Generator &operator=(const Generator &) = delete;
+  ~Generator() {
+    if (this->handle) {
+      this->handle.destroy();
+    }
+  }
+
+  /// Runs up to the first value. Call once.
+  Iterator begin() {
+    Iterator it(this->handle);
+    if (this->handle) {
+      ++it;
+    }
+    return it;
+  }
+  std::default_sentinel_t end() {
+    return {};
+  }
+};
+
+/// Tokens of `text`, as `ChunkLexer` passes them to its callback, ending
+/// with End. Contents are views into `text`, except for the rare token
+/// running across a block end, which is copied. A view is valid until the
+/// iterator is advanced. Tokens waiting to be pulled, copied contents and
+/// the frame are allocated from `resource`. `text` must outlive the
+/// generator.
+Generator<LexView> tokens(std::allocator_arg_t, std::pmr::memory_resource *resource,
+                          std::string_view text);
+
+inline Generator<LexView> tokens(std::string_view text) {
+  return tokens(std::allocator_arg, std::pmr::get_default_resource(), text);
+}
+
+/// Top-level nodes of `text`, as `Parser` fed by `Lexer` passes them to its
+/// callback, without End. Work stops where the consumer stops pulling.
+/// Nodes, those waiting to be pulled and the frame are allocated from
+/// `resource`. `text` must outlive
+/// the generator.
+Generator<Node> nodes(std::allocator_arg_t, std::pmr::memory_resource *resource,
+                      std::string_view text, MessageEmitter emitter = [](Message &&) {});
+
+inline Generator<Node> nodes(std::string_view text, MessageEmitter emitter = [](Message &&) {}) {
+  return nodes(std::allocator_arg, std::pmr::get_default_resource(), text, std::move(emitter));
+}
+
+}
+
+#endif //BBCODE__GENERATOR_H_
@@ -259,7 +259,7 @@ void trim(std::string_view &sv, const std::unordered_set<i8> &c) {
   }
 }
 
-std::unordered_multimap<std::string, NodeDescriptor> NODE_MAP = {
+std::unordered_multimap<std::string, NodeDescriptor, StringHash, StringEqual> NODE_MAP = {
     // [b][/b] bold text
     {"b", {
         .type = Simple,
@@ -313,7 +313,7 @@ std::unordered_multimap<std::string, NodeDescriptor> NODE_MAP = {
               std::vector<std::string_view> fonts;
               std::stringstream ss;
 
-              do {
+              while (true) {
                 auto font = s.substr(start, end - start);
                 auto org_font = font;
                 trim(font, {' ', '"', '\''});
@@ -346,9 +346,21 @@ std::unordered_multimap<std::string, NodeDescriptor> NODE_MAP = {
                   });
                 }
 
+                if (end == std::string_view::npos) {
+                  break;
+                }
+
                 start = end + 1;
                 end = s.find(',', start);
-              } while (end != std::string_view::npos);
+              }
+
+              if (fonts.empty()) {
+                ss << "Invalid font parameter: no font name in `" << s << "`";
+                return ValidateResult{
+                    .result = ValidateResult::Error,
+                    .content = ss.str()
+                };
+              }
 
               for (const auto &font : fonts) {
                 ss << font << ',';
@@ -605,7 +617,7 @@ std::unordered_multimap<std::string, NodeDescriptor> NODE_MAP = {
         .parents = {"tr"}
     }},
 };
-decltype(NODE_MAP)::iterator get_descriptor(const std::string &name,
+decltype(NODE_MAP)::iterator get_descriptor(std::string_view name,
                                             NodeType type) {
   auto match = NODE_MAP.equal_range(name);
   auto descriptor = match.first;
@@ -620,4 +632,50 @@ decltype(NODE_MAP)::iterator get_descriptor(const std::string &name,
   }
 }
 
+struct TagIndex {
+  std::vector<TagInfo> table;
+  std::unordered_map<std::string, usize, StringHash, StringEqual> ids;
+
+  TagIndex() {
+    for (const auto &[name, descriptor] : NODE_MAP) {
+      if (this->ids.try_emplace(name, this->table.size()).second) {
+        this->table.push_back(TagInfo {.name = name, .closable = false});
+      }
+    }
+
+    for (const auto &[name, descriptor] : NODE_MAP) {
+      auto &info = this->table[this->ids.find(name)->second];
+      if (descriptor.type != Omission && descriptor.type != Greedy) {
+        info.closable = true;
+      }
+
+      if (descriptor.type == Greedy) {
+        const auto &terminator = std::get<Greedy>(descriptor.d).terminator;
+        info.stops.resize(this->table.size());
+        for (usize id = 0; id < this->table.size(); ++id) {
+          info.stops[id] = !terminator.contains(this->table[id].name);
+          if (info.stops[id] && this->table[id].name != name) {
+            info.blocks.push_back(id);
+          }
+        }
+      }
+    }
+  }
+};
+
+static const TagIndex &tag_index() {
+  static const TagIndex index;
+  return index;
+}
+
+const std::vector<TagInfo> &tag_table() {
+  return tag_index().table;
+}
+
+usize tag_id(std::string_view name) {
+  const auto &ids = tag_index().ids;
+  auto it = ids.find(name);
+  return it == ids.end() ? NO_TAG : it->second;
+}
+
 }
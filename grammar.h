@@ -7,6 +7,7 @@
 
 #include <vector>
 #include <string>
+#include <string_view>
 #include <optional>
 #include <variant>
 #include <functional>
@@ -56,6 +57,24 @@ enum NodeType {
 
 const NodeType MAX_NODE = Verbatim;
 
+/// Hash accepting any string type, so lookups with `std::string_view` or
+/// `std::pmr::string` don't build a temporary `std::string`.
+struct StringHash {
+  using is_transparent = void;
+  usize operator()(std::string_view s) const {
+    return std::hash<std::string_view>{}(s);
+  }
+};
+
+struct StringEqual {
+  using is_transparent = void;
+  bool operator()(std::string_view a, std::string_view b) const {
+    return a == b;
+  }
+};
+
+typedef std::unordered_set<std::string, StringHash, StringEqual> NameSet;
+
 struct ValidateResult {
   enum {
     Error = 0,
@@ -65,6 +84,8 @@ struct ValidateResult {
   std::string content;
 };
 
+/// Messages given to the emitter have `offset` relative to the parameter;
+/// the parser makes them absolute.
 typedef std::function<ValidateResult(std::string_view,
                                      const MessageEmitter &)>
     Validator;
@@ -74,7 +95,7 @@ struct NodeParametricDescriptor {
 };
 
 struct NodeGreedyDescriptor {
-  std::unordered_set<std::string> terminator;
+  NameSet terminator;
 };
 
 struct NodeDescriptor {
@@ -86,13 +107,35 @@ struct NodeDescriptor {
                NodeParametricDescriptor,
                NodeGreedyDescriptor> d;
 
-  std::unordered_set<std::string> children;
-  std::unordered_set<std::string> parents;
+  NameSet children;
+  NameSet parents;
+};
+
+extern std::unordered_multimap<std::string, NodeDescriptor, StringHash, StringEqual> NODE_MAP;
+
+decltype(NODE_MAP)::iterator get_descriptor(std::string_view name, NodeType type);
+
+const usize NO_TAG = ~usize(0);
+
+/// Per name facts of `NODE_MAP`, indexed by a dense tag id.
+struct TagInfo {
+  std::string name;
+
+  /// has a type with close tag, i.e. not only Omission or Greedy
+  bool closable;
+
+  /// for Greedy tags, whether the close tag of each id stops at this node
+  /// instead of passing it, i.e. is not in the terminator
+  std::vector<bool> stops;
+
+  /// ids set in `stops`, other than this tag
+  std::vector<usize> blocks;
 };
 
-extern std::unordered_multimap<std::string, NodeDescriptor> NODE_MAP;
+const std::vector<TagInfo> &tag_table();
 
-decltype(NODE_MAP)::iterator get_descriptor(const std::string& name, NodeType type);
+/// Tag id of name, or `NO_TAG`.
+usize tag_id(std::string_view name);
 
 }
 
@@ -0,0 +1,164 @@
+#include "incremental.h"
+#include <algorithm>
+#include <iterator>
+#include <cassert>
+
+namespace bbcode::incremental {
+
+// deltas are added modulo 2^64, so moving back works too
+static void shift(Node &node, usize lines, usize bytes) {
+  node.line += lines;
+  node.offset += bytes;
+  for (auto &child : node.children) {
+    shift(child, lines, bytes);
+  }
+}
+
+static void shift(Message &message, usize lines, usize bytes) {
+  message.line += lines;
+  message.offset += bytes;
+}
+
+Document::Document(std::string text) : text(std::move(text)) {
+  std::vector<Segment> fresh(1);
+  usize lines = 0;
+  this->parse(fresh, 0, 0, 0, lines);
+  this->segments = std::move(fresh);
+}
+
+/// Parse from the start of `fresh.back()` into `fresh`, to the end, or to
+/// the first line start at or past `clean` that is the start of one of
+/// `segments` from `first` on moved by `delta` bytes. Returns its index, or
+/// `segments.size()`, and sets `lines` to the change in lines there.
+usize Document::parse(std::vector<Segment> &fresh, usize clean, usize delta, usize first, usize &lines) {
+  auto found = this->segments.size();
+  auto from = fresh.back().offset;
+  auto from_line = fresh.back().line;
+
+  // nodes and messages come relative to `from`
+  parser::Parser parser([&fresh, from, from_line](Node &&node) {
+    if (node.type == grammar::End) {
+      return;
+    }
+    // the newline ending a segment is passed on after the next one began
+    auto *segment = &fresh.back();
+    if (from + node.offset < segment->offset) {
+      segment = &fresh[fresh.size() - 2];
+    }
+    shift(node, from_line - segment->line, from - segment->offset);
+    segment->nodes.push_back(std::move(node));
+  }, [&fresh, from, from_line](Message &&message) {
+    auto &segment = fresh.back();
+    shift(message, from_line - segment.line, from - segment.offset);
+    segment.messages.push_back(std::move(message));
+  });
+
+  lexer::Lexer lexer([&](lexer::LexItem &&item) {
+    auto newline = item.type == lexer::Newline;
+    auto line = item.line;
+    auto chr = item.chr;
+    auto end = item.offset + 1;
+    parser.put(std::move(item));
+    if (!newline || !parser.at_line_start()) {
+      return;
+    }
+
+    auto start = Segment {
+        .offset = from + end,
+        .line = from_line + line + 1,
+    };
+
+    if (start.offset >= clean) {
+      auto it = std::lower_bound(this->segments.begin() + isize(first), this->segments.end(),
+                                 start.offset - delta,
+                                 [](const Segment &s, usize offset) {
+                                   return s.offset < offset;
+                                 });
+      if (it != this->segments.end() && it->offset == start.offset - delta) {
+        found = usize(it - this->segments.begin());
+        lines = start.line - it->line;
+        // the newline held by the parser ends an edited line, so it is not
+        // reused but passed on as the parser would
+        auto &segment = fresh.back();
+        segment.nodes.push_back(Node {
+            .type = grammar::Newline,
+            .line = from_line + line - segment.line,
+            .chr = chr,
+            .offset = from + end - 1 - segment.offset,
+            .span = 1,
+            .data = "\n",
+        });
+        return;
+      }
+    }
+
+    fresh.push_back(std::move(start));
+  });
+
+  for (auto i = from; i < this->text.size(); ++i) {
+    lexer.put(static_cast<i8>(this->text[i]));
+    if (found != this->segments.size()) {
+      return found;
+    }
+  }
+
+  lexer.finish();
+  return found;
+}
+
+usize Document::edit(usize offset, usize removed, std::string_view inserted) {
+  assert(offset + removed <= this->text.size());
+  this->text.replace(offset, removed, inserted);
+  auto delta = inserted.size() - removed;
+
+  // the newline before a segment starting at `offset` is not touched
+  auto start = usize(std::upper_bound(this->segments.begin(), this->segments.end(), offset,
+                                      [](usize offset, const Segment &s) {
+                                        return offset < s.offset;
+                                      }) - this->segments.begin()) - 1;
+  auto from = this->segments[start].offset;
+
+  std::vector<Segment> fresh(1);
+  fresh.back().offset = from;
+  fresh.back().line = this->segments[start].line;
+  usize lines = 0;
+  auto found = this->parse(fresh, offset + inserted.size(), delta, start + 1, lines);
+
+  // rest of the text is unchanged from the found segment on, so only its
+  // start moves and its nodes are not touched
+  for (auto i = found; i < this->segments.size(); ++i) {
+    this->segments[i].offset += delta;
+    this->segments[i].line += lines;
+  }
+  auto parsed = (found == this->segments.size() ? this->text.size() : this->segments[found].offset) - from;
+
+  auto begin = this->segments.begin() + isize(start);
+  this->segments.erase(begin, this->segments.begin() + isize(found));
+  this->segments.insert(this->segments.begin() + isize(start),
+                        std::make_move_iterator(fresh.begin()), std::make_move_iterator(fresh.end()));
+  return parsed;
+}
+
+std::vector<Node> Document::get_nodes() const {
+  std::vector<Node> nodes;
+  for (const auto &segment : this->segments) {
+    for (auto node : segment.nodes) {
+      shift(node, segment.line, segment.offset);
+      nodes.push_back(std::move(node));
+    }
+  }
+  return nodes;
+}
+
+std::vector<Message> Document::get_messages() const {
+  std::vector<Message> messages;
+  for (const auto &segment : this->segments) {
+    for (auto message : segment.messages) {
+      shift(message, segment.line, segment.offset);
+      messages.push_back(std::move(message));
+    }
+  }
+  return messages;
+}
+
+}
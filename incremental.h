@@ -0,0 +1,66 @@
+#ifndef BBCODE__INCREMENTAL_H_
+#define BBCODE__INCREMENTAL_H_
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "parser.h"
+
+namespace bbcode::incremental {
+
+using bbcode::parser::Node;
+
+/// Text from one line start with no tag open to the next, from where the
+/// rest of the text parses the same as a document of its own.
+///
+/// Lines and offsets of its nodes and messages are relative to the start,
+/// so an edit before it only moves `offset` and `line`.
+struct Segment {
+  usize offset;
+  usize line;
+  /// top-level nodes, including the newline ending it
+  std::vector<Node> nodes;
+  /// messages emitted from its start on
+  std::vector<Message> messages;
+};
+
+/// Parse result kept up to date across edits, for live preview.
+///
+/// An edit reparses from the start of the segment it falls in, and stops at
+/// the first line start past the inserted text that falls on an old segment
+/// start. Segments from there on are reused as they are, moved by the
+/// change in lines and bytes. When an edit opens or closes a tag the
+/// segment starts after it vanish, and the rest of the document is parsed
+/// again.
+///
+/// Documents are parsed without `ParseLimits`.
+class Document {
+ private:
+  std::string text;
+  std::vector<Segment> segments;
+
+ private:
+  usize parse(std::vector<Segment> &fresh, usize clean, usize delta, usize first, usize &lines);
+ public:
+  explicit Document(std::string text);
+  /// Replace `removed` bytes at `offset` with `inserted`. Returns bytes parsed.
+  usize edit(usize offset, usize removed, std::string_view inserted);
+  const std::string &get_text() const {
+    return this->text;
+  }
+  /// Segments in order, with positions relative to each, see `Segment`.
+  const std::vector<Segment> &get_segments() const {
+    return this->segments;
+  }
+  /// Top-level nodes with absolute positions, as `Parser` passes them to its
+  /// callback. Copies every node; a preview redrawing only what changed
+  /// should use `get_segments`.
+  std::vector<Node> get_nodes() const;
+  /// Messages with absolute positions, copied like `get_nodes`.
+  std::vector<Message> get_messages() const;
+};
+
+}
+
+#endif //BBCODE__INCREMENTAL_H_
@@ -8,11 +8,11 @@
 namespace bbcode::lexer {
 
 void Lexer::send_buffer(LexType type) {
-  if (this->buffer.rdbuf()->in_avail() != 0) {
-    auto content = this->buffer.str();
+  if (!this->buffer.empty()) {
+    std::pmr::string content(this->buffer, this->resource);
     switch (type) {
       case Constant:
-        this->callback(LexItem{
+        this->emit(LexItem{
             .type = Constant,
             .line = this->line,
             .chr = this->chr - content.size(),
@@ -24,7 +24,7 @@ void Lexer::send_buffer(LexType type) {
         break;
 
       case Literal:
-        this->callback(LexItem{
+        this->emit(LexItem{
             .type = Literal,
             .line = this->line,
             .chr = this->chr - content.size() - 1,
@@ -38,18 +38,28 @@ void Lexer::send_buffer(LexType type) {
       default:break;
     }
 
-    this->buffer.str("");
+    this->buffer.clear();
   }
 }
 
+void Lexer::reset() {
+  this->buffer.clear();
+  this->cursor.reset();
+  this->left_tag = false;
+  this->line = 0;
+  this->chr = 0;
+  this->offset = 0;
+}
+
 void Lexer::put(i8 c) {
   ++this->chr;
   ++this->offset;
+  BBCODE_STAT(this->stats, ++stat.bytes);
 
   if (this->left_tag) {
     this->left_tag = false;
     if (c == '/') {
-      this->callback(LexItem{
+      this->emit(LexItem{
         .type = CloseTagLeft,
         .line = this->line,
         .chr = this->chr - 2,
@@ -58,7 +68,7 @@ void Lexer::put(i8 c) {
       return;
     }
     else {
-      this->callback(LexItem{
+      this->emit(LexItem{
         .type = OpenTagLeft,
         .line = this->line,
         .chr = this->chr - 2,
@@ -78,9 +88,14 @@ void Lexer::put(i8 c) {
     case '\n':cur_type = Newline;
       break;
     case '[':this->send_buffer(Literal);
+      this->cursor.reset();
       this->left_tag = true;
       break;
-    default:this->buffer.put(c);
+    default:
+      BBCODE_STAT(this->stats,
+                  stat.allocations += grows(this->buffer, 1);
+                  ++stat.trie_walks);
+      this->buffer += char(c);
       auto[result, valid] = this->cursor.walk(c);
       assert(valid);
       constant = result == trie::Found;
@@ -90,8 +105,10 @@ void Lexer::put(i8 c) {
   }
 
   if (cur_type != Invalid) {
+    // constant can't span across tag characters
     this->send_buffer(Literal);
-    this->callback(LexItem{
+    this->cursor.reset();
+    this->emit(LexItem{
         .type = cur_type,
         .line = this->line,
         .chr =this->chr - 1,
@@ -105,30 +122,30 @@ void Lexer::put(i8 c) {
   }
   else if (constant) {
     std::size_t curr = this->cursor.step();
-    auto result = this->buffer.str();
+    const auto result = std::string_view(this->buffer);
     std::size_t extra = result.size() - curr;
     if (extra > 0) {
-      this->callback(LexItem{
+      this->emit(LexItem{
           .type = Literal,
           .line = this->line,
           .chr = this->chr - result.size(),
           .offset = this->offset - result.size(),
           .d = LexItemLiteralDetail{
-              .content = result.substr(0, extra)
+              .content = std::pmr::string(result.substr(0, extra), this->resource)
           }
       });
 
-      this->callback(LexItem{
+      this->emit(LexItem{
           .type = Constant,
           .line = this->line,
           .chr = this->chr - curr,
           .offset = this->offset - curr,
           .d = LexItemConstantDetail{
-              .content = result.substr(extra)
+              .content = std::pmr::string(result.substr(extra), this->resource)
           }
       });
 
-      this->buffer.str("");
+      this->buffer.clear();
     }
     else {
       this->send_buffer(Constant);
@@ -138,6 +155,107 @@ void Lexer::put(i8 c) {
   }
 }
 
+std::string_view ChunkLexer::pending(std::string_view chunk, usize start, usize end) {
+  if (this->carry.empty()) {
+    return chunk.substr(start, end - start);
+  }
+
+  BBCODE_STAT(this->stats, stat.allocations += grows(this->carry, end - start));
+  this->carry.append(chunk.substr(start, end - start));
+  return this->carry;
+}
+
+void ChunkLexer::send_literal(std::string_view chunk, usize start, usize end) {
+  auto text = this->pending(chunk, start, end);
+  if (!text.empty()) {
+    this->emit(Literal, text.size() + 1, text);
+  }
+  this->carry.clear();
 }
 
+void ChunkLexer::put(std::string_view chunk) {
+  // pending text is carry followed by chunk[start, i)
+  usize start = 0;
 
+  for (usize i = 0; i < chunk.size(); ++i) {
+    auto c = static_cast<i8>(chunk[i]);
+    ++this->chr;
+    ++this->offset;
+    BBCODE_STAT(this->stats, ++stat.bytes);
+
+    if (this->left_tag) {
+      this->left_tag = false;
+      if (c == '/') {
+        this->emit(CloseTagLeft, 2);
+        start = i + 1;
+        continue;
+      }
+      this->emit(OpenTagLeft, 2);
+    }
+
+    switch (c) {
+      case ']':
+      case '=':
+      case '\n':
+        // constant can't span across tag characters
+        this->send_literal(chunk, start, i);
+        this->cursor.reset();
+        this->emit(c == ']' ? TagRight : c == '=' ? Equal : Newline, 1);
+        if (c == '\n') {
+          ++this->line;
+          this->chr = 0;
+        }
+        start = i + 1;
+        break;
+      case '[':
+        this->send_literal(chunk, start, i);
+        this->cursor.reset();
+        this->left_tag = true;
+        start = i + 1;
+        break;
+      default: {
+        BBCODE_STAT(this->stats, ++stat.trie_walks);
+        auto[result, valid] = this->cursor.walk(c);
+        assert(valid);
+        if (result == trie::NotFound) {
+          this->cursor.reset();
+        } else if (result == trie::Found) {
+          std::size_t curr = this->cursor.step();
+          auto text = this->pending(chunk, start, i + 1);
+          std::size_t extra = text.size() - curr;
+          if (extra > 0) {
+            this->emit(Literal, text.size(), text.substr(0, extra));
+          }
+          this->emit(Constant, curr, text.substr(extra));
+          this->carry.clear();
+          this->cursor.reset();
+          start = i + 1;
+        }
+      }
+    }
+  }
+
+  if (start < chunk.size()) {
+    BBCODE_STAT(this->stats, stat.allocations += grows(this->carry, chunk.size() - start));
+    this->carry.append(chunk.substr(start));
+  }
+}
+
+void ChunkLexer::finish() {
+  // pending text ends as if at one more byte
+  ++this->chr;
+  ++this->offset;
+  this->send_literal({}, 0, 0);
+  this->emit(End, 1);
+}
+
+void ChunkLexer::reset() {
+  this->carry.clear();
+  this->cursor.reset();
+  this->left_tag = false;
+  this->line = 0;
+  this->chr = 0;
+  this->offset = 0;
+}
+
+}
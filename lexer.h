@@ -7,11 +7,13 @@
 
 #include "defs.h"
 #include "trie.h"
+#include "stats.h"
 #include <vector>
 #include <memory>
 #include <variant>
-#include <sstream>
+#include <string>
 #include <functional>
+#include <memory_resource>
 
 namespace bbcode::lexer {
 
@@ -45,11 +47,21 @@ enum LexType {
 };
 
 struct LexItemConstantDetail {
-  std::string content;
+  std::pmr::string content;
 };
 
 struct LexItemLiteralDetail {
-  std::string content;
+  std::pmr::string content;
+};
+
+/// Non-owning view of a token. `content` is only valid during the call it
+/// is passed to.
+struct LexView {
+  LexType type;
+  usize line;
+  usize chr;
+  usize offset;
+  std::string_view content;
 };
 
 struct LexItem {
@@ -68,31 +80,69 @@ struct LexItem {
 
 class Lexer {
  private:
-  std::stringstream buffer;
+  std::string buffer;
   bbcode::TrieCursor cursor;
   std::function<void(LexItem &&)> callback;
   bool left_tag;
   usize line;
   usize chr;
   usize offset;
+  std::pmr::memory_resource *resource;
+#ifdef BBCODE_STATS
+  ParseStats *stats = nullptr;
+#endif
 
  private:
   void send_buffer(LexType type);
+  void emit(LexItem &&item) {
+    BBCODE_STAT(this->stats,
+                ++stat.tokens[item.type];
+                if (item.type == Constant || item.type == Literal) {
+                  auto size = item.type == Constant ? std::get<Constant>(item.d).content.size()
+                                                    : std::get<Literal>(item.d).content.size();
+                  stat.literal_bytes += size;
+                  stat.allocations += size > std::string().capacity();
+                });
+    this->callback(std::move(item));
+  }
  public:
   Lexer() : Lexer([](const auto &&) {}) {}
+  /// Token contents are allocated from `resource`.
   template<class T>
-  explicit Lexer(T callback)
+  explicit Lexer(T callback,
+                 std::pmr::memory_resource *resource = std::pmr::get_default_resource())
       : cursor(Trie::get_cursor()),
         callback(callback),
         left_tag(false),
         line(0),
         chr(0),
-        offset(0) {}
+        offset(0),
+        resource(resource) {}
+  /// Attach stats to fill. No-op unless built with `BBCODE_STATS`.
+  void set_stats([[maybe_unused]] ParseStats *s) {
+#ifdef BBCODE_STATS
+    this->stats = s;
+#endif
+  }
   void put(i8 c);
+  /// Return to initial state for a new document, keeping buffer capacity.
+  void reset();
+  /// Like `reset`, and allocate token contents from `resource`.
+  void reset(std::pmr::memory_resource *resource) {
+    this->resource = resource;
+    this->reset();
+  }
+  void put(std::string_view s) {
+    for (const auto &c : s) {
+      this->put(static_cast<i8>(c));
+    }
+  }
   void finish() {
+    // pending text ends as if at one more byte
     ++this->chr;
+    ++this->offset;
     this->send_buffer(Literal);
-    this->callback(LexItem{
+    this->emit(LexItem{
       .type = End,
       .line = this->line,
       .chr =this->chr - 1,
@@ -101,6 +151,61 @@ class Lexer {
   }
 };
 
+/// Lexer over input arriving in chunks of any size. Text inside one chunk is
+/// passed as a view into it; only text running across the end of a chunk
+/// (a partial literal or emoticon) is carried in an internal buffer. Tokens
+/// and positions are the same as with `Lexer`. Views are only valid during
+/// the callback.
+class ChunkLexer {
+ private:
+  std::string carry;
+  bbcode::TrieCursor cursor;
+  std::function<void(const LexView &)> callback;
+  bool left_tag;
+  usize line;
+  usize chr;
+  usize offset;
+#ifdef BBCODE_STATS
+  ParseStats *stats = nullptr;
+#endif
+
+ private:
+  /// Text pending from `start` to `end` of chunk, after any carried text.
+  std::string_view pending(std::string_view chunk, usize start, usize end);
+  void send_literal(std::string_view chunk, usize start, usize end);
+  void emit(LexType type, usize back, std::string_view content = {}) {
+    BBCODE_STAT(this->stats,
+                ++stat.tokens[type];
+                stat.literal_bytes += content.size());
+    this->callback(LexView {
+        .type = type,
+        .line = this->line,
+        .chr = this->chr - back,
+        .offset = this->offset - back,
+        .content = content,
+    });
+  }
+ public:
+  template<class T>
+  explicit ChunkLexer(T callback)
+      : cursor(Trie::get_cursor()),
+        callback(callback),
+        left_tag(false),
+        line(0),
+        chr(0),
+        offset(0) {}
+  /// Attach stats to fill. No-op unless built with `BBCODE_STATS`.
+  void set_stats([[maybe_unused]] ParseStats *s) {
+#ifdef BBCODE_STATS
+    this->stats = s;
+#endif
+  }
+  void put(std::string_view chunk);
+  void finish();
+  /// Return to initial state for a new document, keeping buffer capacity.
+  void reset();
+};
+
 }
 
 #endif //BBCODE__LEXER_H_
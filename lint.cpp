@@ -0,0 +1,25 @@
+#include "lint.h"
+#include "engine.h"
+
+namespace bbcode::lint {
+
+Result check(std::string_view text, const parser::ParseLimits &limits) {
+  Result result;
+  engine::Engine engine([](parser::Node &&) {}, [](Message &&) {});
+  engine.set_lint(true);
+  engine.set_limits(limits);
+  engine.set_diagnostics([&result](const Diagnostic &diagnostic) {
+    switch (diagnostic.severity) {
+      case Tidy: ++result.notes; break;
+      case Warning: ++result.warnings; break;
+      case Error: ++result.errors; break;
+    }
+    result.messages.push_back(to_message(diagnostic));
+  });
+
+  engine.put(text);
+  engine.finish();
+  return result;
+}
+
+}
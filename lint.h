@@ -0,0 +1,30 @@
+#ifndef BBCODE__LINT_H_
+#define BBCODE__LINT_H_
+
+#include <string_view>
+#include <vector>
+
+#include "parser.h"
+
+namespace bbcode::lint {
+
+struct Result {
+  std::vector<Message> messages;
+  usize errors = 0;
+  usize warnings = 0;
+  usize notes = 0;
+
+  /// No error or warning, notes are only tidying hints.
+  bool clean() const {
+    return this->errors == 0 && this->warnings == 0;
+  }
+};
+
+/// Check a document for the same messages as a full parse, without
+/// building its tree or keeping its text. Memory is bound by nesting depth
+/// and the messages. Counts are of the messages reported under `limits`.
+Result check(std::string_view text, const parser::ParseLimits &limits = {});
+
+}
+
+#endif //BBCODE__LINT_H_
@@ -0,0 +1,108 @@
+#include "message.h"
+#include <algorithm>
+
+namespace {
+
+struct Format {
+  const char *name;
+  // "%" is replaced by the subject and "$" by the tag
+  const char *text;
+};
+
+const Format FORMATS[] = {
+    {"unexpected-node", "Unexpected node marked as Invalid."},
+    {"unmatched-tag-type", "Tag with unmatched type `%` interpreted as normal text."},
+    {"unknown-tag-type", "Tag with unmatched type `%` interpreted as normal text."},
+    {"unknown-open-tag", "Unknown open tag `%` interpreted as normal text."},
+    {"bad-parameter", "`%` is not valid parameter of $ tag. This tag will be decayed to normal text."},
+    {"depth-limit", "Nesting depth limit reached, tag `%` interpreted as normal text."},
+    {"unknown-close-tag", "Unknown close tag `%` ignored."},
+    {"unpaired-close-tag", "Unpaired close tag `%` ignored."},
+    {"missing-close-tag", "Missing close tag for `%` node."},
+    {"incomplete-tag", "Incomplete tag `%` interpreted as normal text."},
+    {"message-limit", "Message limit reached, further messages are dropped."},
+    {"size-limit", "Text size limit reached, rest of input is dropped."},
+    {"node-limit", "Node limit reached, rest of input is interpreted as normal text."},
+    {"cancelled", "Parse cancelled, rest of input is interpreted as normal text."},
+    {"time-limit", "Time limit reached, rest of input is interpreted as normal text."},
+    {"", "%"},
+};
+
+static_assert(std::size(FORMATS) == CustomMessage + 1);
+
+}
+
+std::string_view message_name(const Diagnostic &diagnostic) {
+  return diagnostic.code == CustomMessage ? diagnostic.tag : FORMATS[diagnostic.code].name;
+}
+
+std::string format_message(const Diagnostic &diagnostic) {
+  std::string text;
+  for (const char *c = FORMATS[diagnostic.code].text; *c; ++c) {
+    switch (*c) {
+      case '%':
+        text += diagnostic.subject;
+        break;
+      case '$':
+        text += diagnostic.tag;
+        break;
+      default:
+        text += *c;
+    }
+  }
+  return text;
+}
+
+void MessageDigest::add(const Diagnostic &diagnostic) {
+  ++this->severities[diagnostic.severity];
+
+  // validator messages have no tag, their subject is the whole text
+  auto tag = diagnostic.code == BadParameter ? diagnostic.tag :
+      diagnostic.code == CustomMessage ? std::string_view() : diagnostic.subject;
+  this->key.assign(message_name(diagnostic));
+  this->key += '\0';
+  this->key += tag;
+
+  auto it = this->index.find(this->key);
+  if (it != this->index.end()) {
+    auto &group = this->groups[it->second];
+    ++group.count;
+    group.last_line = diagnostic.line;
+    group.last_chr = diagnostic.chr;
+    group.last_offset = diagnostic.offset;
+    return;
+  }
+
+  if (this->groups.size() >= this->max_groups) {
+    ++this->dropped;
+    return;
+  }
+
+  this->index.emplace(this->key, this->groups.size());
+  this->groups.push_back(MessageGroup {
+      .first = to_message(diagnostic),
+      .count = 1,
+      .last_line = diagnostic.line,
+      .last_chr = diagnostic.chr,
+      .last_offset = diagnostic.offset,
+  });
+}
+
+void MessageDigest::clear() {
+  this->dropped = 0;
+  std::fill(std::begin(this->severities), std::end(this->severities), 0);
+  this->groups.clear();
+  this->index.clear();
+}
+
+Message to_message(const Diagnostic &diagnostic) {
+  return Message {
+      .severity = diagnostic.severity,
+      .line = diagnostic.line,
+      .chr = diagnostic.chr,
+      .offset = diagnostic.offset,
+      .span = diagnostic.span,
+      .name = std::string(message_name(diagnostic)),
+      .message = format_message(diagnostic),
+  };
+}
@@ -6,7 +6,12 @@
 #define BBCODE__MESSAGE_H_
 
 #include <string>
+#include <string_view>
 #include <functional>
+#include <unordered_map>
+#include <vector>
+
+#include "defs.h"
 
 enum Severity {
   Tidy,
@@ -28,4 +33,104 @@ struct Message {
 
 typedef std::function<void(Message&&)> MessageEmitter;
 
+/// Bit per `Severity` of the messages to report.
+typedef u8 SeverityMask;
+
+constexpr SeverityMask severity_bit(Severity severity) {
+  return SeverityMask(1u << severity);
+}
+
+const SeverityMask ALL_SEVERITIES = severity_bit(Tidy) | severity_bit(Warning) | severity_bit(Error);
+
+enum MessageCode : u8 {
+  UnexpectedNode,
+  UnmatchedTagType,
+  UnknownTagType,
+  UnknownOpenTag,
+  BadParameter,
+  DepthLimit,
+  UnknownCloseTag,
+  UnpairedCloseTag,
+  MissingCloseTag,
+  IncompleteTag,
+  MessageLimit,
+  SizeLimit,
+  NodeLimit,
+  Cancelled,
+  TimeLimit,
+  /// from a parameter validator, `tag` is the name and `subject` the text
+  CustomMessage,
+};
+
+/// Message before formatting. Views are only valid during the call it is
+/// passed to.
+struct Diagnostic {
+  Severity severity;
+  MessageCode code;
+
+  usize line;
+  usize chr;
+  usize offset;
+  usize span;
+
+  /// tag name or text the message is about
+  std::string_view subject;
+  /// tag name of BadParameter, whose subject is the parameter
+  std::string_view tag;
+};
+
+typedef std::function<void(const Diagnostic &)> DiagnosticHandler;
+
+/// `Message::name` of a diagnostic, as used in `-W` flags.
+std::string_view message_name(const Diagnostic &diagnostic);
+std::string format_message(const Diagnostic &diagnostic);
+Message to_message(const Diagnostic &diagnostic);
+
+/// Messages of one name and tag, formatted from the first of them.
+struct MessageGroup {
+  Message first;
+  usize count;
+
+  usize last_line;
+  usize last_chr;
+  usize last_offset;
+};
+
+/// Folds the diagnostics of a document into groups by message name and tag,
+/// in order of first occurrence. Only the first of a group is formatted.
+/// Past `max_groups` groups new ones are counted but not kept, so memory is
+/// bound however many messages a document has.
+class MessageDigest {
+ private:
+  usize max_groups;
+  usize dropped = 0;
+  usize severities[Error + 1] = {};
+  std::vector<MessageGroup> groups;
+  std::unordered_map<std::string, usize> index;
+  std::string key;
+
+ public:
+  explicit MessageDigest(usize max_groups = 100) : max_groups(max_groups) {}
+  void add(const Diagnostic &diagnostic);
+  /// For `Parser::set_diagnostics`. The digest must outlive the parser.
+  DiagnosticHandler handler() {
+    return [this](const Diagnostic &diagnostic) {
+      this->add(diagnostic);
+    };
+  }
+  const std::vector<MessageGroup> &messages() const {
+    return this->groups;
+  }
+  /// Messages in no group, as `max_groups` was reached.
+  usize omitted() const {
+    return this->dropped;
+  }
+  /// All messages of `severity` added, grouped or not.
+  usize count(Severity severity) const {
+    return this->severities[severity];
+  }
+  /// Forget all messages, keeping allocated memory.
+  void clear();
+};
+
 #endif //BBCODE__MESSAGE_H_
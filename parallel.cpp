@@ -0,0 +1,233 @@
+#include "parallel.h"
+#include <algorithm>
+#include <thread>
+#include <cassert>
+
+namespace bbcode::parallel {
+
+namespace {
+
+/// Line start with no tag open.
+struct Stop {
+  usize offset;
+  usize line;
+  /// chr of the newline before it, still held by the parser
+  usize chr;
+  /// nodes and messages before the newline
+  usize node;
+  usize message;
+};
+
+struct Segment {
+  usize begin = 0;
+  usize line = 0;
+  std::vector<Node> nodes;
+  std::vector<Message> messages;
+  std::vector<Stop> stops;
+  bool finished = false;
+};
+
+// deltas are added modulo 2^64
+void shift(Node &node, usize lines, usize bytes) {
+  node.line += lines;
+  node.offset += bytes;
+  for (auto &child : node.children) {
+    shift(child, lines, bytes);
+  }
+}
+
+/// Parse `text[segment.begin, end)` as a document starting at a line start,
+/// recording stops. Finishes the document if `end` is the end of text.
+/// With `until`, returns at the first stop past `begin` it accepts.
+template<class F>
+void parse_segment(std::string_view text, Segment &segment, usize end, const parser::ParseLimits &limits,
+                   F until) {
+  parser::Parser parser([&segment](Node &&node) {
+    if (node.type != grammar::End) {
+      shift(node, segment.line, segment.begin);
+      segment.nodes.push_back(std::move(node));
+    }
+  }, [&segment](Message &&message) {
+    message.line += segment.line;
+    message.offset += segment.begin;
+    segment.messages.push_back(std::move(message));
+  });
+  parser.set_limits(limits);
+
+  bool stop = false;
+  lexer::Lexer lexer([&](lexer::LexItem &&item) {
+    auto newline = item.type == lexer::Newline;
+    auto line = item.line;
+    auto chr = item.chr;
+    auto offset = item.offset;
+    parser.put(std::move(item));
+    if (!newline || !parser.at_line_start()) {
+      return;
+    }
+
+    segment.stops.push_back(Stop {
+        .offset = segment.begin + offset + 1,
+        .line = segment.line + line + 1,
+        .chr = chr,
+        .node = segment.nodes.size(),
+        .message = segment.messages.size(),
+    });
+    stop = until(segment.stops.back());
+  });
+
+  for (auto i = segment.begin; i < end; ++i) {
+    lexer.put(static_cast<i8>(text[i]));
+    if (stop) {
+      return;
+    }
+  }
+
+  if (end == text.size()) {
+    lexer.finish();
+    segment.finished = true;
+  }
+}
+
+Node newline(const Stop &stop) {
+  return Node {
+      .type = grammar::Newline,
+      .line = stop.line - 1,
+      .chr = stop.chr,
+      .offset = stop.offset - 1,
+      .span = 1,
+      .data = "\n",
+  };
+}
+
+Result stitch(std::string_view text, usize threads, usize min_chunk, const parser::ParseLimits &limits) {
+  // chunk i is text[begins[i], begins[i + 1]), each starting after a newline
+  std::vector<usize> begins {0};
+  auto chunks = std::max<usize>(1, std::min(threads, text.size() / std::max<usize>(1, min_chunk)));
+  for (usize i = 1; i < chunks; ++i) {
+    auto at = text.find('\n', std::max(begins.back(), text.size() * i / chunks));
+    if (at == std::string_view::npos) {
+      break;
+    }
+    if (at + 1 > begins.back() && at + 1 < text.size()) {
+      begins.push_back(at + 1);
+    }
+  }
+  begins.push_back(text.size());
+
+  std::vector<Segment> segments(begins.size() - 1);
+  for (usize i = 0; i < segments.size(); ++i) {
+    segments[i].begin = begins[i];
+    segments[i].line = i == 0 ? 0 :
+        segments[i - 1].line + usize(std::count(text.begin() + isize(begins[i - 1]),
+                                                 text.begin() + isize(begins[i]), '\n'));
+  }
+
+  {
+    std::vector<std::thread> workers;
+    for (usize i = 1; i < segments.size(); ++i) {
+      workers.emplace_back([&, i]() {
+        parse_segment(text, segments[i], begins[i + 1], limits, [](const Stop &) { return false; });
+      });
+    }
+    parse_segment(text, segments[0], begins[1], limits, [](const Stop &) { return false; });
+    for (auto &worker : workers) {
+      worker.join();
+    }
+  }
+
+  // chunk containing `offset`, and its stop at `offset` if any
+  auto find = [&](usize offset, usize &chunk) -> const Stop * {
+    chunk = std::min(segments.size(),
+                     usize(std::upper_bound(begins.begin(), begins.end(), offset) - begins.begin())) - 1;
+    const auto &stops = segments[chunk].stops;
+    auto it = std::lower_bound(stops.begin(), stops.end(), offset, [](const Stop &s, usize o) {
+      return s.offset < o;
+    });
+    return it != stops.end() && it->offset == offset ? &*it : nullptr;
+  };
+
+  Result result;
+  auto take = [&result](Segment &segment, usize node, usize node_end, usize message, usize message_end) {
+    std::move(segment.nodes.begin() + isize(node), segment.nodes.begin() + isize(node_end),
+              std::back_inserter(result.nodes));
+    std::move(segment.messages.begin() + isize(message), segment.messages.begin() + isize(message_end),
+              std::back_inserter(result.messages));
+  };
+
+  // result holds everything before `at`, a line start with no tag open,
+  // including the newline before it
+  Stop at {};
+  while (true) {
+    usize chunk;
+    const auto *stop = find(at.offset, chunk);
+    auto &segment = segments[chunk];
+
+    // the chunk's nodes hold from here on, up to its last stop
+    if (stop || at.offset == begins[chunk]) {
+      auto node = stop ? stop->node + 1 : 0;
+      auto message = stop ? stop->message : 0;
+      if (segment.finished) {
+        take(segment, node, segment.nodes.size(), message, segment.messages.size());
+        return result;
+      }
+
+      if (!segment.stops.empty() && segment.stops.back().offset > at.offset) {
+        const auto &last = segment.stops.back();
+        take(segment, node, last.node, message, last.message);
+        result.nodes.push_back(newline(last));
+        at = last;
+      }
+    }
+
+    // parse on until a line start where some chunk's nodes hold
+    Segment real;
+    real.begin = at.offset;
+    real.line = at.line;
+    parse_segment(text, real, text.size(), limits, [&](const Stop &s) {
+      usize other;
+      return find(s.offset, other) != nullptr || s.offset == begins[other];
+    });
+
+    if (real.finished) {
+      result.serial_bytes += text.size() - at.offset;
+      take(real, 0, real.nodes.size(), 0, real.messages.size());
+      return result;
+    }
+
+    const auto &last = real.stops.back();
+    result.serial_bytes += last.offset - at.offset;
+    take(real, 0, last.node, 0, last.message);
+    result.nodes.push_back(newline(last));
+    at = last;
+  }
+}
+
+}
+
+Result parse(std::string_view text, usize threads, usize min_chunk, const parser::ParseLimits &limits) {
+  // messages of a chunk before its first stop may be wrong and must not
+  // count, so the message limit is applied once stitched
+  auto chunk_limits = limits;
+  chunk_limits.max_messages = 0;
+  auto result = stitch(text, threads, min_chunk, chunk_limits);
+  if (!limits.max_messages) {
+    return result;
+  }
+
+  auto &messages = result.messages;
+  if (messages.size() > limits.max_messages) {
+    auto &first = messages[limits.max_messages];
+    first = to_message(Diagnostic {
+        .severity = Warning,
+        .code = MessageLimit,
+        .line = first.line,
+        .chr = first.chr,
+        .offset = first.offset,
+        .span = first.span,
+    });
+    messages.resize(limits.max_messages + 1);
+  }
+  return result;
+}
+
+}
@@ -0,0 +1,40 @@
+#ifndef BBCODE__PARALLEL_H_
+#define BBCODE__PARALLEL_H_
+
+#include <string_view>
+#include <vector>
+
+#include "parser.h"
+
+namespace bbcode::parallel {
+
+using bbcode::parser::Node;
+
+struct Result {
+  /// top-level nodes, as `Parser` passes them to its callback
+  std::vector<Node> nodes;
+  std::vector<Message> messages;
+  /// bytes parsed again on the calling thread while stitching
+  usize serial_bytes = 0;
+};
+
+/// Parse one large document on up to `threads` threads, with the same nodes
+/// and messages as `Lexer` feeding `Parser`.
+///
+/// The text is split after newlines into chunks of at least `min_chunk`
+/// bytes, each parsed as if it started a document. A chunk's nodes hold
+/// from every line start where it had no tag open. Chunks are stitched in
+/// order: where the real parse is not at such a line start, it continues
+/// on the calling thread until it reaches one, and the rest of the chunk is
+/// taken from there.
+///
+/// `limits` apply to each chunk and each reparse on their own, except that
+/// messages past `max_messages` are dropped as for the whole document. The
+/// result is the same as a serial parse under `limits` unless the node or
+/// text limit or the deadline is hit.
+Result parse(std::string_view text, usize threads, usize min_chunk = 1 << 20,
+             const parser::ParseLimits &limits = {});
+
+}
+
+#endif //BBCODE__PARALLEL_H_
@@ -5,18 +5,84 @@
 #include "parser.h"
 #include <cassert>
 #include <algorithm>
+#include <optional>
 
 namespace bbcode::parser {
 
+void Parser::emit(const Diagnostic &diagnostic) {
+  if (!(this->severities & severity_bit(diagnostic.severity))) {
+    return;
+  }
+
+  if (this->limits.max_messages && this->messages >= this->limits.max_messages) {
+    if (this->messages++ == this->limits.max_messages && (this->severities & severity_bit(Warning))) {
+      BBCODE_STAT(this->stats, ++stat.messages[Warning]);
+      this->report(Diagnostic {
+          .severity = Warning,
+          .code = MessageLimit,
+          .line = diagnostic.line,
+          .chr = diagnostic.chr,
+          .offset = diagnostic.offset,
+          .span = diagnostic.span,
+      });
+    }
+    return;
+  }
+
+  ++this->messages;
+  BBCODE_STAT(this->stats, ++stat.messages[diagnostic.severity]);
+  this->report(diagnostic);
+}
+
+void Parser::emit(const Message &message) {
+  this->emit(Diagnostic {
+      .severity = message.severity,
+      .code = CustomMessage,
+      .line = message.line,
+      .chr = message.chr,
+      .offset = message.offset,
+      .span = message.span,
+      .subject = message.message,
+      .tag = message.name,
+  });
+}
+
+void Parser::report(const Diagnostic &diagnostic) {
+  if (this->diagnostics) {
+    this->diagnostics(diagnostic);
+  } else {
+    this->emitter(to_message(diagnostic));
+  }
+}
+
+void Parser::index(usize id, NodeType type, bool push) {
+  auto position = push ? this->stack.size() : this->stack.size() - 1;
+  auto update = [&](usize tag) {
+    if (push) {
+      this->stops[tag].push_back(position);
+    } else {
+      assert(this->stops[tag].back() == position);
+      this->stops[tag].pop_back();
+    }
+  };
+
+  update(id);
+  if (type == grammar::Greedy) {
+    // close tags not terminating a greedy node can't pass it
+    for (auto other : grammar::tag_table()[id].blocks) {
+      update(other);
+    }
+  }
+}
+
 void Parser::as_invalid(Node& node) {
-  this->emitter(Message {
+  this->emit(Diagnostic {
       .severity = Warning,
+      .code = UnexpectedNode,
       .line = node.line,
       .chr = node.chr,
       .offset = node.offset,
       .span = node.span,
-      .name = "unexpected-node",
-      .message = "Unexpected node marked as Invalid.",
   });
 
   switch (node.type) {
@@ -32,7 +98,8 @@ void Parser::as_invalid(Node& node) {
       node.type = grammar::Invalid;
       break;
     case grammar::Parametric:
-      node.name = node.name + "=" + node.data;
+      node.name += '=';
+      node.name += node.data;
       node.data.clear();
       node.type = grammar::Invalid;
       break;
@@ -42,38 +109,102 @@ void Parser::as_invalid(Node& node) {
   }
 }
 
-void Parser::finish(Node&& node) {
-  if (node.type == grammar::Literal && node.data.empty()) {
-    return;
-  }
-
+bool Parser::misplaced(const Node &node) const {
+  bool tag = node.type >= 0 && node.type <= grammar::MAX_NODE;
   if (this->stack.empty()) {
-    if (node.type >= 0 && node.type <= grammar::MAX_NODE) {
+    if (tag) {
       auto descriptor = grammar::get_descriptor(node.name, node.type);
       assert(descriptor != grammar::NODE_MAP.end());
-      if (!descriptor->second.parents.empty()) {
-        as_invalid(node);
-      }
+      return !descriptor->second.parents.empty();
     }
-    this->callback(std::move(node));
-  } else {
-    const auto& parent = this->stack.back();
-    auto parent_descriptor = grammar::get_descriptor(parent.name, parent.type);
-    assert(parent_descriptor != grammar::NODE_MAP.end());
-
-    if (!parent_descriptor->second.children.empty() &&
-        !parent_descriptor->second.children.contains(node.name)) {
-      as_invalid(node);
-    } else if (node.type >= 0 && node.type <= grammar::MAX_NODE) {
-      auto child_descriptor = grammar::get_descriptor(node.name, node.type);
-      assert(child_descriptor != grammar::NODE_MAP.end());
-
-      if (!child_descriptor->second.parents.empty() &&
-          !child_descriptor->second.parents.contains(parent.name)) {
-        as_invalid(node);
-      }
+    return false;
+  }
+
+  const auto& parent = this->stack.back();
+  auto parent_descriptor = grammar::get_descriptor(parent.name, parent.type);
+  assert(parent_descriptor != grammar::NODE_MAP.end());
+
+  if (!parent_descriptor->second.children.empty() &&
+      !parent_descriptor->second.children.contains(node.name)) {
+    return true;
+  }
+
+  if (tag) {
+    auto child_descriptor = grammar::get_descriptor(node.name, node.type);
+    assert(child_descriptor != grammar::NODE_MAP.end());
+    return !child_descriptor->second.parents.empty() &&
+        !child_descriptor->second.parents.contains(parent.name);
+  }
+
+  return false;
+}
+
+void Parser::enter(const Node &node) {
+  // the node is not on the stack yet, so its parent is the back as in `finish`
+  auto event = Event {
+      .type = Enter,
+      .node = node.type,
+      .name = node.name,
+      .data = node.data,
+      .line = node.line,
+      .chr = node.chr,
+      .offset = node.offset,
+      .span = node.span,
+  };
+
+  std::string name;
+  if (this->misplaced(node)) {
+    // as `as_invalid` will name it
+    event.node = grammar::Invalid;
+    if (node.type == grammar::Parametric) {
+      name = std::string(node.name) + '=' + std::string(node.data);
+      event.name = name;
+      event.data = {};
     }
+  }
+
+  this->events(event);
+}
+
+void Parser::finish(Node&& node, usize id) {
+  if (node.type == grammar::Literal && node.span == 0) {
+    return;
+  }
 
+  ++this->nodes;
+
+  bool tag = node.type >= 0 && node.type <= grammar::MAX_NODE;
+  if (this->misplaced(node)) {
+    as_invalid(node);
+  }
+  if (this->lookup) {
+    this->lookup->add(id, node.type, node.data, node.line, node.chr, node.offset, node.span);
+  }
+
+  if (this->events || this->lint) {
+    BBCODE_STAT(this->stats, ++stat.nodes[usize(node.type + 1)]);
+    if (this->events) {
+      this->events(Event {
+          .type = tag ? Leave : Leaf,
+          .node = node.type,
+          .name = node.name,
+          .data = node.data,
+          .line = node.line,
+          .chr = node.chr,
+          .offset = node.offset,
+          .span = node.span,
+      });
+    }
+    if (!this->stack.empty()) {
+      this->stack.back().span += node.span;
+    }
+  } else if (this->stack.empty()) {
+    BBCODE_STAT(this->stats, ++stat.nodes[usize(node.type + 1)]);
+    this->callback(std::move(node));
+  } else {
+    BBCODE_STAT(this->stats,
+                ++stat.nodes[usize(node.type + 1)];
+                stat.allocations += grows(this->stack.back().children, 1));
     this->stack.back().span += node.span;
     this->stack.back().children.push_back(std::move(node));
   }
@@ -84,31 +215,39 @@ void Parser::finish_back() {
     return;
   }
 
-  auto node = std::move(this->stack.back());
-  this->stack.pop_back();
+  auto id = this->ids.back();
+  auto node = this->pop();
 
-  this->finish(std::move(node));
+  this->finish(std::move(node), id);
 }
 
-void Parser::push_literal(std::string &&s) {
+void Parser::push_literal(std::string_view s) {
+  BBCODE_STAT(this->stats, stat.literal_bytes += s.size());
   if (this->state == Parameter) {
     this->parameter += s;
     return;
   }
 
   assert(this->state == Literal || this->state == Verbatim);
+  auto kept = this->fit(s, false);
+  if (kept < s.size()) {
+    const auto &back = this->stack.back();
+    this->cut = this->cut.value_or(back.offset + back.span + kept);
+    if (kept == 0) {
+      return;
+    }
+    s = s.substr(0, kept);
+  }
 
   if (this->stack.back().type == grammar::Literal) {
-    this->stack.back().data += s;
-    this->stack.back().span = this->stack.back().data.size();
+    if (!this->lint) {
+      BBCODE_STAT(this->stats, stat.allocations += grows(this->stack.back().data, s.size()));
+      this->stack.back().data += s;
+    }
+    this->stack.back().span += s.size();
   } else {
-    auto back = std::move(this->stack.back());
-    this->stack.pop_back();
-    auto literal = Node {
-      .type = NodeType::Literal,
-      .offset = back.offset + back.span,
-      .span = s.size()
-    };
+    auto back = this->pop();
+    auto literal = this->node(NodeType::Literal, 0, 0, back.offset + back.span, s.size());
     if (back.type == grammar::Newline) {
       literal.line = back.line + 1;
       literal.chr = 0;
@@ -116,55 +255,49 @@ void Parser::push_literal(std::string &&s) {
       literal.line = back.line;
       literal.chr = back.chr + back.span;
     }
-    literal.data = s;
+    if (!this->lint) {
+      literal.data = s;
+    }
     this->finish(std::move(back));
-    this->stack.push_back(std::move(literal));
+    this->push(std::move(literal));
   }
 }
 
-void Parser::open_node(lexer::LexItem&& item) {
+void Parser::open_node(const LexView &item) {
   bool matched = false;
   if (this->state == TagOpenKnown) {
     auto match = grammar::NODE_MAP.equal_range(this->name);
     for (auto it = match.first; it != match.second; ++it) {
       if (it->second.type != grammar::Parametric) {
         this->finish_back();
-        if (!this->stack.empty() && this->stack.back().type == grammar::Greedy &&
+        // a greedy node at top level has no parent to check
+        if (this->stack.size() > 1 && this->stack.back().type == grammar::Greedy &&
             it->second.type == grammar::Greedy) {
           auto parent = ++this->stack.rbegin();
           auto parent_descriptor = grammar::get_descriptor(parent->name, parent->type);
-          if (parent_descriptor->second.children.contains(this->name)) {
+          if (parent_descriptor != grammar::NODE_MAP.end() &&
+              parent_descriptor->second.children.contains(this->name)) {
             this->finish_back();
           }
         }
 
-        this->stack.push_back(Node {
-            .type = it->second.type,
-            .name = this->name,
-            .line = item.line,
-            .chr = item.chr - this->name.size() - 1,
-            .offset = item.offset - this->name.size() - 1,
-            .span = this->name.size() + 2,
-        });
+        if (it->second.type != grammar::Omission && this->too_deep(this->stack.size())) {
+          this->keep_as_text(item, "[" + this->name + "]");
+          return;
+        }
+
+        auto node = this->node(it->second.type,
+                               item.line,
+                               item.chr - this->name.size() - 1,
+                               item.offset - this->name.size() - 1,
+                               this->name.size() + 2);
+        node.name = this->name;
+        this->push(std::move(node));
 
         if (it->second.type == grammar::Omission) {
-          this->push_node(Node {
-              .type = NodeType::Literal,
-              .line = item.line,
-              .chr = item.chr + 1,
-              .offset = item.offset + 1,
-              .span = 0,
-              .data = "",
-          });
+          this->push_node(this->node(NodeType::Literal, item.line, item.chr + 1, item.offset + 1, 0));
         } else {
-          this->stack.push_back(Node {
-              .type = NodeType::Literal,
-              .line = item.line,
-              .chr = item.chr + 1,
-              .offset = item.offset + 1,
-              .span = 0,
-              .data = "",
-          });
+          this->push(this->node(NodeType::Literal, item.line, item.chr + 1, item.offset + 1, 0));
         }
 
 
@@ -195,75 +328,82 @@ void Parser::open_node(lexer::LexItem&& item) {
     }
 
     // unknown tag
-    std::stringstream ss;
     std::string literal = "[" + this->name + "]";
     if (matched) {
-      ss << "Tag with unmatched type `" << this->name << "` interpreted as normal text.";
-      this->emitter(Message {
+      this->emit(Diagnostic {
           .severity = Warning,
+          .code = UnmatchedTagType,
           .line = item.line,
           .chr = item.chr - this->name.size() - 1,
           .offset = item.offset - this->name.size() - 1,
           .span = literal.size(),
-          .name = "unmatched-tag-type",
-          .message = ss.str(),
+          .subject = this->name,
       });
     } else {
-      ss << "Unknown open tag `" << this->name << "` interpreted as normal text.";
-      this->emitter(Message {
+      this->emit(Diagnostic {
           .severity = Tidy,
+          .code = UnknownOpenTag,
           .line = item.line,
           .chr = item.chr - this->name.size() - 1,
           .offset = item.offset - this->name.size() - 1,
           .span = literal.size(),
-          .name = "unknown-open-tag",
-          .message = ss.str(),
+          .subject = this->name,
       });
     }
 
     this->state = this->before_tag;
-    this->push_literal(std::move(literal));
+    this->push_literal(literal);
   } else if (this->state == Parameter) {
     auto match = grammar::NODE_MAP.equal_range(this->name);
     for (auto it = match.first; it != match.second; ++it) {
       if (it->second.type == grammar::Parametric) {
-        auto result = std::get<NodeType::Parametric>(it->second.d)
-            .validator(this->parameter, this->emitter);
+        // the top of stack is the literal before this tag
+        if (this->too_deep(this->stack.size() - 1)) {
+          this->keep_as_text(item, "[" + this->name + "=" + this->parameter + "]");
+          return;
+        }
+
+        grammar::ValidateResult result;
+        {
+          BBCODE_STAT(this->stats, ++stat.validator_calls);
+          BBCODE_STAT_TIMER(this->stats, validator_ns);
+          // validators report offsets within the parameter, which ends
+          // right before the "]" item
+          const MessageEmitter warn = [this, &item](Message &&message) {
+            message.line = item.line;
+            message.chr = item.chr - this->parameter.size() + message.offset;
+            message.offset = item.offset - this->parameter.size() + message.offset;
+            this->emit(message);
+          };
+          result = std::get<NodeType::Parametric>(it->second.d)
+              .validator(this->parameter, warn);
+        }
         if (result.result) {
           this->finish_back();
-          this->stack.push_back(Node {
-              .type = NodeType::Parametric,
-              .name = this->name,
-              .line = item.line,
-              .chr = item.chr - this->name.size() - this->parameter.size() - 2,
-              .offset = item.offset - this->name.size() - this->parameter.size() - 2,
-              .span = this->name.size() + this->parameter.size() + 3,
-              .data = std::move(result.content)
-          });
-
-          this->stack.push_back(Node {
-              .type = NodeType::Literal,
-              .line = item.line,
-              .chr = item.chr + 1,
-              .offset = item.offset + 1,
-              .span = 0,
-              .data = "",
-          });
+          auto node = this->node(NodeType::Parametric,
+                                 item.line,
+                                 item.chr - this->name.size() - this->parameter.size() - 2,
+                                 item.offset - this->name.size() - this->parameter.size() - 2,
+                                 this->name.size() + this->parameter.size() + 3);
+          node.name = this->name;
+          node.data = result.content;
+          this->push(std::move(node));
+
+          this->push(this->node(NodeType::Literal, item.line, item.chr + 1, item.offset + 1, 0));
           this->state = Literal;
           this->name.clear();
           this->parameter.clear();
           return;
         } else {
-          std::stringstream ss;
-          ss << "`" << this->parameter << "` is not valid parameter of " << this->name << " tag. This tag will be decayed to normal text.";
-          this->emitter(Message {
+          this->emit(Diagnostic {
             .severity = Error,
+            .code = BadParameter,
             .line = item.line,
             .chr = item.chr - this->parameter.size(),
             .offset = item.offset - this->parameter.size(),
             .span = this->parameter.size(),
-            .name = "bad-parameter",
-            .message = ss.str(),
+            .subject = this->parameter,
+            .tag = this->name,
           });
 
           this->state = this->before_tag;
@@ -278,44 +418,70 @@ void Parser::open_node(lexer::LexItem&& item) {
     }
 
     // unknown tag
-    std::stringstream ss;
     std::string literal = "[" + this->name + "=" + this->parameter + "]";
 
     if (matched) {
-      ss << "Tag with unmatched type `" << this->name << "` interpreted as normal text.";
-      this->emitter(Message {
+      this->emit(Diagnostic {
           .severity = Warning,
+          .code = UnknownTagType,
           .line = item.line,
           .chr = item.chr - this->name.size() - this->parameter.size() - 2,
           .offset = item.offset - this->name.size() - this->parameter.size() - 2,
           .span = literal.size(),
-          .name = "unknown-tag-type",
-          .message = ss.str(),
+          .subject = this->name,
       });
     } else {
-      ss << "Unknown open tag `" << this->name << "` interpreted as normal text.";
-      this->emitter(Message {
+      this->emit(Diagnostic {
           .severity = Tidy,
+          .code = UnknownOpenTag,
           .line = item.line,
           .chr = item.chr - this->name.size() - this->parameter.size() - 2,
           .offset = item.offset - this->name.size() - this->parameter.size() - 2,
           .span = literal.size(),
-          .name = "unknown-open-tag",
-          .message = ss.str(),
+          .subject = this->name,
       });
     }
 
     this->state = this->before_tag;
-    this->push_literal(std::move(literal));
+    this->push_literal(literal);
+  }
+
+  this->name.clear();
+  this->parameter.clear();
+}
+
+void Parser::keep_as_text(const LexView &item, std::string &&literal) {
+  this->emit(Diagnostic {
+      .severity = Warning,
+      .code = DepthLimit,
+      .line = item.line,
+      .chr = item.chr + 1 - literal.size(),
+      .offset = item.offset + 1 - literal.size(),
+      .span = literal.size(),
+      .subject = literal,
+  });
+
+  // the literal before the tag may be finished already
+  if (this->stack.empty() || this->stack.back().type <= grammar::MAX_NODE) {
+    this->push(this->node(NodeType::Literal,
+                          item.line,
+                          item.chr + 1 - literal.size(),
+                          item.offset + 1 - literal.size(),
+                          0));
   }
 
+  this->state = this->before_tag;
+  this->push_literal(literal);
   this->name.clear();
   this->parameter.clear();
 }
 
-void Parser::close_node(lexer::LexItem &&item) {
+void Parser::close_node(const LexView &item) {
+  BBCODE_STAT(this->stats, ++stat.close_tags);
+  BBCODE_STAT_TIMER(this->stats, close_ns);
+
   if (this->stack.size() > 1 && (++this->stack.rbegin())->type == grammar::Verbatim) {
-    if (this->name != (++this->stack.rbegin())->name) {
+    if (std::string_view(this->name) != (++this->stack.rbegin())->name) {
       this->state = Verbatim;
       this->push_literal("[/" + this->name + "]");
     } else {
@@ -323,14 +489,7 @@ void Parser::close_node(lexer::LexItem &&item) {
       this->finish_back();
       this->finish_back();
       this->state = Literal;
-      this->stack.push_back(Node {
-          .type = NodeType::Literal,
-          .line = item.line,
-          .chr = item.chr + 1,
-          .offset = item.offset + 1,
-          .span = 0,
-          .data = "",
-      });
+      this->push(this->node(NodeType::Literal, item.line, item.chr + 1, item.offset + 1, 0));
     }
 
     this->name.clear();
@@ -338,21 +497,16 @@ void Parser::close_node(lexer::LexItem &&item) {
     return;
   }
 
-  auto match_cur = grammar::NODE_MAP.equal_range(this->name);
-  if (match_cur.first == match_cur.second ||
-  std::all_of(match_cur.first, match_cur.second, [](const auto& a) {
-    return a.second.type == grammar::Omission || a.second.type == grammar::Greedy;
-  })) {
-    std::stringstream ss;
-    ss << "Unknown close tag `" << this->name << "` ignored.";
-    this->emitter(Message {
+  auto id = grammar::tag_id(this->name);
+  if (id == grammar::NO_TAG || !grammar::tag_table()[id].closable) {
+    this->emit(Diagnostic {
         .severity = Tidy,
+        .code = UnknownCloseTag,
         .line = item.line,
         .chr = item.chr - this->name.size() - 2,
         .offset = item.offset - this->name.size() - 2,
         .span = this->name.size() + 3,
-        .name = "unknown-close-tag",
-        .message = ss.str(),
+        .subject = this->name,
     });
 
     this->state = this->before_tag;
@@ -361,45 +515,34 @@ void Parser::close_node(lexer::LexItem &&item) {
     return;
   }
 
-  bool hold_back = false;
-  Node back;
+  // moved out of stack rather than assigned, so it keeps its allocator
+  std::optional<Node> back;
   switch (this->stack.back().type) {
     case grammar::Literal:
     case grammar::Constant:
     case grammar::Newline:
-      back = this->stack.back();
-      this->stack.pop_back();
-      hold_back = true;
+      back.emplace(this->pop());
       break;
     default:
       break;
   }
 
   if (this->stack.empty()) {
-    std::stringstream ss;
-    ss << "Unpaired close tag `" << this->name << "` ignored.";
-    this->emitter(Message {
+    this->emit(Diagnostic {
         .severity = Warning,
+        .code = UnpairedCloseTag,
         .line = item.line,
         .chr = item.chr - this->name.size() - 2,
         .offset = item.offset - this->name.size() - 2,
         .span = this->name.size() + 3,
-        .name = "unpaired-close-tag",
-        .message = ss.str(),
+        .subject = this->name,
     });
 
     this->state = this->before_tag;
-    if (hold_back) {
-      this->stack.push_back(std::move(back));
+    if (back) {
+      this->push(std::move(*back));
     } else {
-      this->stack.push_back(Node {
-          .type = NodeType::Literal,
-          .line = item.line,
-          .chr = item.chr + 1,
-          .offset = item.offset + 1,
-          .span = 0,
-          .data = "",
-      });
+      this->push(this->node(NodeType::Literal, item.line, item.chr + 1, item.offset + 1, 0));
     }
 
     this->name.clear();
@@ -407,47 +550,25 @@ void Parser::close_node(lexer::LexItem &&item) {
     return;
   }
 
-  auto it = this->stack.rbegin();
-  const auto end = this->stack.size() > 8 ? it + 8 : this->stack.rend();
-  for (; it < end; ++it) {
-    if (it->name == this->name) {
-      break;
-    }
-
-    if (it->type == grammar::Greedy) {
-      auto descriptor = grammar::get_descriptor(it->name, grammar::Greedy);
-      assert(descriptor != grammar::NODE_MAP.end());
-      if (!std::get<NodeType::Greedy>(descriptor->second.d).terminator.contains(this->name)) {
-        break;
-      }
-    }
-  }
-
-  if (it == end) {
-    std::stringstream ss;
-    ss << "Unpaired close tag `" << this->name << "` ignored.";
-    this->emitter(Message {
+  // innermost open tag of this name, or Greedy node it can't pass
+  const auto &stops = this->stops[id];
+  const auto window = this->limits.close_window;
+  if (stops.empty() || (window && this->stack.size() - stops.back() > window)) {
+    this->emit(Diagnostic {
         .severity = Warning,
+        .code = UnpairedCloseTag,
         .line = item.line,
         .chr = item.chr - this->name.size() - 2,
         .offset = item.offset - this->name.size() - 2,
         .span = this->name.size() + 3,
-        .name = "unpaired-close-tag",
-        .message = ss.str(),
+        .subject = this->name,
     });
 
     this->state = this->before_tag;
-    if (hold_back) {
-      this->stack.push_back(std::move(back));
+    if (back) {
+      this->push(std::move(*back));
     } else {
-      this->stack.push_back(Node {
-          .type = NodeType::Literal,
-          .line = item.line,
-          .chr = item.chr + 1,
-          .offset = item.offset + 1,
-          .span = 0,
-          .data = "",
-      });
+      this->push(this->node(NodeType::Literal, item.line, item.chr + 1, item.offset + 1, 0));
     }
 
     this->name.clear();
@@ -455,28 +576,27 @@ void Parser::close_node(lexer::LexItem &&item) {
     return;
   }
 
-  this->finish(std::move(back));
-  ++it;
+  if (back) {
+    this->finish(std::move(*back));
+  }
+  auto it = this->stack.rbegin() + isize(this->stack.size() - stops.back());
 
+  // every iteration finishes the back, so it2 is always the back
   for (auto it2 = this->stack.rbegin(); it2 != it; ++it2) {
-    if (it2->type == grammar::Greedy) {
-      auto descriptor = grammar::get_descriptor(it2->name, it2->type);
-      if (std::get<grammar::Greedy>(descriptor->second.d).terminator.contains(this->name)) {
-        goto FINISH;
-      }
+    if (it2->type == grammar::Greedy && !grammar::tag_table()[this->ids.back()].stops[id]) {
+      goto FINISH;
     }
 
     if (it2 + 1 != it) {
-      std::stringstream ss;
-      ss << "Missing close tag for `" << it2->name << "` node.";
-      this->emitter(Message {
+      BBCODE_STAT(this->stats, ++stat.close_recoveries);
+      this->emit(Diagnostic {
           .severity = Warning,
+          .code = MissingCloseTag,
           .line = it2->line,
           .chr = it2->chr,
           .offset = it2->offset,
           .span = it2->span,
-          .name = "missing-close-tag",
-          .message = ss.str(),
+          .subject = it2->name,
       });
     } else {
       this->stack.back().span += this->name.size() + 3;
@@ -496,14 +616,7 @@ void Parser::close_node(lexer::LexItem &&item) {
     }
   }
 
-  this->stack.push_back(Node {
-      .type = NodeType::Literal,
-      .line = item.line,
-      .chr = item.chr + 1,
-      .offset = item.offset + 1,
-      .span = 0,
-      .data = "",
-  });
+  this->push(this->node(NodeType::Literal, item.line, item.chr + 1, item.offset + 1, 0));
 
   this->name.clear();
   this->parameter.clear();
@@ -538,15 +651,13 @@ void Parser::flush_state() {
       assert(false);
   }
 
-  std::stringstream ss;
-  ss << "Incomplete tag `" << literal << "` interpreted as normal text.";
   auto& back = this->stack.back();
-  auto message = Message {
+  auto message = Diagnostic {
       .severity = Warning,
-      .offset = back.offset - this->parameter.size(),
+      .code = IncompleteTag,
+      .offset = back.offset + back.span,
       .span = literal.size(),
-      .name = "incomplete-tag",
-      .message = ss.str(),
+      .subject = literal,
   };
 
   if (back.type == grammar::Newline) {
@@ -557,17 +668,19 @@ void Parser::flush_state() {
     message.chr = back.chr + back.span;
   }
 
-  this->emitter(std::move(message));
-  this->push_literal(std::move(literal));
+  this->emit(message);
+  this->name.clear();
+  this->parameter.clear();
+  this->push_literal(literal);
 }
 
 void Parser::push_node(Node&& node) {
   if (this->stack.back().type == grammar::Literal && node.type == grammar::Literal) {
     this->stack.back().data += node.data;
-    this->stack.back().span = this->stack.back().data.size();
+    this->stack.back().span += node.span;
   } else {
     this->finish_back();
-    this->stack.push_back(std::move(node));
+    this->push(std::move(node));
   }
 }
 
@@ -576,40 +689,238 @@ void Parser::close() {
     return;
   }
 
-  std::stringstream ss;
   while (!this->stack.empty()) {
     auto& back = this->stack.back();
 
-    if (back.type >= 0 && back.type <= grammar::MAX_NODE) {
-      ss << "Missing close tag for `" << back.name << "` node.";
-      this->emitter(Message {
+    if (back.type >= 0 && back.type <= grammar::MAX_NODE && !this->quiet() && !this->cut) {
+      this->emit(Diagnostic {
           .severity = Warning,
+          .code = MissingCloseTag,
           .line = back.line,
           .chr = back.chr,
           .offset = back.offset,
           .span = back.span,
-          .name = "missing-close-tag",
-          .message = ss.str(),
+          .subject = back.name,
       });
-
-      ss.str("");
     }
 
     this->finish_back();
   }
 
-  this->callback(Node {
-    .type = NodeType::End,
-  });
+  if (this->events) {
+    this->events(Event {
+        .type = Finish,
+        .node = NodeType::End,
+    });
+  } else if (!this->lint) {
+    this->callback(Node {
+        .type = NodeType::End,
+    });
+  }
 
   this->state = Done;
 }
 
+void Parser::reset() {
+  this->stack.clear();
+  this->ids.clear();
+  for (auto &stops : this->stops) {
+    stops.clear();
+  }
+  this->push(this->node(NodeType::Literal, 0, 0, 0, 0));
+  this->name.clear();
+  this->parameter.clear();
+  this->state = Literal;
+  this->before_tag = Literal;
+  this->items = 0;
+  this->nodes = 0;
+  this->literal_bytes = 0;
+  this->messages = 0;
+  this->visible = 0;
+  this->degraded = false;
+  this->truncated = false;
+  this->cut.reset();
+}
+
+bool Parser::over_size(const LexView &item) {
+  if (!this->limits.max_literal_bytes) {
+    return false;
+  }
+
+  switch (item.type) {
+    case lexer::Constant:
+    case lexer::Literal:
+      this->literal_bytes += item.content.size();
+      break;
+    default:
+      ++this->literal_bytes;
+      break;
+  }
+
+  if (this->literal_bytes <= this->limits.max_literal_bytes) {
+    return false;
+  }
+
+  this->emit(Diagnostic {
+      .severity = Error,
+      .code = SizeLimit,
+      .line = item.line,
+      .chr = item.chr,
+      .offset = item.offset,
+      .span = 0,
+  });
+  this->truncated = true;
+  return true;
+}
+
+bool Parser::over_limit(const LexView &item) {
+  if (this->limits.max_nodes && this->nodes >= this->limits.max_nodes) {
+    this->degrade(item, NodeLimit);
+    return true;
+  }
+
+  if (++this->items % ParseLimits::CHECK_INTERVAL != 0) {
+    return false;
+  }
+
+  if (this->limits.cancel != nullptr && this->limits.cancel->load(std::memory_order_relaxed)) {
+    this->degrade(item, Cancelled);
+    return true;
+  }
+
+  if (this->limits.deadline != std::chrono::steady_clock::time_point::max() &&
+      std::chrono::steady_clock::now() >= this->limits.deadline) {
+    this->degrade(item, TimeLimit);
+    return true;
+  }
+
+  return false;
+}
+
+void Parser::degrade(const LexView &item, MessageCode code) {
+  this->emit(Diagnostic {
+      .severity = Error,
+      .code = code,
+      .line = item.line,
+      .chr = item.chr,
+      .offset = item.offset,
+      .span = 0,
+  });
+
+  switch (this->state) {
+    case TagOpen:
+    case TagOpenKnown:
+    case Parameter:
+    case TagClose:
+    case TagCloseKnown:
+      this->flush_state();
+      break;
+    default:
+      break;
+  }
+
+  this->degraded = true;
+}
+
+void Parser::put_text(const LexView &item) {
+  switch (item.type) {
+    case lexer::Newline:
+      this->push_literal("\n");
+      break;
+    case lexer::OpenTagLeft:
+      this->push_literal("[");
+      break;
+    case lexer::CloseTagLeft:
+      this->push_literal("[/");
+      break;
+    case lexer::TagRight:
+      this->push_literal("]");
+      break;
+    case lexer::Equal:
+      this->push_literal("=");
+      break;
+    case lexer::Constant:
+    case lexer::Literal:
+      this->push_literal(item.content);
+      break;
+    case lexer::End:
+      this->close();
+      break;
+    case lexer::Invalid:
+      assert(false);
+      return;
+  }
+}
+
+/// Bytes of `s` within the visible limit, counting characters. With `whole`,
+/// `s` is one character.
+usize Parser::fit(std::string_view s, bool whole) {
+  if (!this->limits.max_visible) {
+    return s.size();
+  }
+
+  for (usize i = 0; i < s.size(); ++i) {
+    // UTF-8 continuation bytes belong to the character before
+    if ((u8(s[i]) & 0xc0) == 0x80) {
+      continue;
+    }
+    if (this->cut || this->visible == this->limits.max_visible) {
+      return i;
+    }
+    ++this->visible;
+    if (whole) {
+      break;
+    }
+  }
+  return s.size();
+}
+
+void Parser::reset(std::pmr::memory_resource *resource) {
+  this->resource = resource;
+  this->reset();
+}
+
 void Parser::put(LexItem &&item) {
+  std::string_view content;
+  if (item.type == lexer::Constant) {
+    content = std::get<lexer::Constant>(item.d).content;
+  }
+  else if (item.type == lexer::Literal) {
+    content = std::get<lexer::Literal>(item.d).content;
+  }
+
+  this->put(LexView {
+      .type = item.type,
+      .line = item.line,
+      .chr = item.chr,
+      .offset = item.offset,
+      .content = content,
+  });
+}
+
+void Parser::put(const LexView &item) {
+  this->step(item);
+  if (this->cut && this->state != Done) {
+    this->close();
+  }
+}
+
+void Parser::step(const LexView &item) {
   if (this->state == Done) {
     return;
   }
 
+  if (item.type != lexer::End) {
+    if (this->truncated || this->over_size(item)) {
+      return;
+    }
+
+    if (this->degraded || this->over_limit(item)) {
+      this->put_text(item);
+      return;
+    }
+  }
+
   switch (item.type) {
     case lexer::Newline: {
       switch (this->state) {
@@ -622,14 +933,13 @@ void Parser::put(LexItem &&item) {
           [[fallthrough]];
         case Literal:
         case Verbatim: {
-          this->push_node(Node {
-              .type = grammar::Newline,
-              .line = item.line,
-              .chr = item.chr,
-              .offset = item.offset,
-              .span = 1,
-              .data = "\n"
-          });
+          if (this->fit("\n", true) == 0) {
+            this->cut = this->cut.value_or(item.offset);
+            break;
+          }
+          auto node = this->node(grammar::Newline, item.line, item.chr, item.offset, 1);
+          node.data = "\n";
+          this->push_node(std::move(node));
           break;
         }
         case Done:
@@ -688,11 +998,11 @@ void Parser::put(LexItem &&item) {
         }
         case TagOpenKnown:
         case Parameter: {
-          this->open_node(std::move(item));
+          this->open_node(item);
           break;
         }
         case TagCloseKnown: {
-          this->close_node(std::move(item));
+          this->close_node(item);
           break;
         }
         case Done:
@@ -709,11 +1019,11 @@ void Parser::put(LexItem &&item) {
         }
         case Literal:
         case Verbatim:
-        case TagOpen:
         case Parameter: {
           this->push_literal("=");
           break;
         }
+        case TagOpen:
         case TagClose:
         case TagCloseKnown: {
           this->flush_state();
@@ -727,7 +1037,7 @@ void Parser::put(LexItem &&item) {
       break;
     }
     case lexer::Constant: {
-      auto content = std::move(std::get<lexer::Constant>(item.d).content);
+      auto content = item.content;
       switch (this->state) {
         case TagOpen:
         case TagOpenKnown:
@@ -737,18 +1047,17 @@ void Parser::put(LexItem &&item) {
           this->flush_state();
         [[fallthrough]];
         case Literal: {
-          this->push_node(Node {
-            .type = NodeType::Constant,
-            .line = item.line,
-            .chr = item.chr,
-            .offset = item.offset,
-            .span = content.size(),
-            .data = content
-          });
+          if (this->fit(content, true) == 0) {
+            this->cut = this->cut.value_or(item.offset);
+            break;
+          }
+          auto node = this->node(NodeType::Constant, item.line, item.chr, item.offset, content.size());
+          node.data = content;
+          this->push_node(std::move(node));
           break;
         }
         case Verbatim: {
-          this->push_literal(std::move(content));
+          this->push_literal(content);
           break;
         }
         case Done:
@@ -758,11 +1067,11 @@ void Parser::put(LexItem &&item) {
       break;
     }
     case lexer::Literal: {
-      auto content = std::move(std::get<lexer::Literal>(item.d).content);
+      auto content = item.content;
       switch (this->state) {
         case Literal:
         case Verbatim: {
-          this->push_literal(std::move(content));
+          this->push_literal(content);
           break;
         }
         case TagOpen: {
@@ -5,19 +5,27 @@
 #ifndef BBCODE__PARSER_H_
 #define BBCODE__PARSER_H_
 
-#include <deque>
+#include <vector>
+#include <algorithm>
+#include <memory_resource>
+#include <chrono>
+#include <atomic>
+#include <optional>
 
 #include "grammar.h"
 #include "lexer.h"
+#include "query.h"
 
 namespace bbcode::parser {
 
 using bbcode::grammar::NodeType;
 using namespace bbcode::lexer;
 
+/// Strings and children of a node are allocated from the memory resource
+/// of the `Parser` producing it, and keep it when moved.
 struct Node {
   NodeType type;
-  std::string name;
+  std::pmr::string name;
   usize line;
   usize chr;
   usize offset;
@@ -26,12 +34,69 @@ struct Node {
   // for *Parametric, this is the parameter.
   // for Literal, this is text data.
   // for other, this should be empty and not used.
-  std::string data;
+  std::pmr::string data;
 
   // for Literal and Newline, this should always been empty;
-  std::vector<Node> children;
+  std::pmr::vector<Node> children;
 };
 
+/// Limits on the work spent on one document. Zero means unlimited.
+///
+/// When the depth limit is hit, the open tag is kept as normal text. When
+/// the node limit, deadline or cancellation is hit, the rest of the input
+/// is kept as normal text. When the literal limit is hit, the rest of the
+/// input is dropped. Messages past the message limit are dropped. When the
+/// visible limit is hit, the text is cut there, open tags are closed
+/// without messages and the parser is done.
+struct ParseLimits {
+  /// open tags
+  usize max_depth = 0;
+  /// finished nodes
+  usize max_nodes = 0;
+  /// text taken from items, counting one per tag character
+  usize max_literal_bytes = 0;
+  usize max_messages = 0;
+  /// characters of text, constants and newlines shown, for previews
+  usize max_visible = 0;
+
+  /// close tags match open tags at most this many levels up
+  usize close_window = 8;
+
+  /// checked every `CHECK_INTERVAL` items
+  std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+  const std::atomic<bool> *cancel = nullptr;
+
+  static const usize CHECK_INTERVAL = 256;
+};
+
+enum EventType {
+  /// open tag, `span` is the open tag
+  Enter = 0,
+  /// tag closed or recovered, `span` is the whole node
+  Leave,
+  /// text, constant or newline
+  Leaf,
+  /// end of input
+  Finish,
+};
+
+/// Node reported without its children. Strings are only valid during the
+/// call. Tags and leaves not allowed where they are have `node` Invalid
+/// from `Enter` on, as they would in the tree.
+struct Event {
+  EventType type;
+  NodeType node;
+  std::string_view name;
+  // parameter of Parametric, text of leaves
+  std::string_view data;
+  usize line;
+  usize chr;
+  usize offset;
+  usize span;
+};
+
+typedef std::function<void(const Event &)> EventHandler;
+
 enum ParserState {
   Literal,
   Verbatim,
@@ -45,41 +110,189 @@ enum ParserState {
 
 class Parser {
  private:
-  std::deque<Node> stack;
+  std::vector<Node> stack;
+
+  // tag id of each stack entry, and per tag id the stack positions where
+  // its close tag stops: open tags of that name and Greedy barriers
+  std::vector<usize> ids;
+  std::vector<std::vector<usize>> stops;
   std::string name;
   std::string parameter;
   ParserState state;
   ParserState before_tag;
+  std::pmr::memory_resource *resource;
+
+  ParseLimits limits;
+  usize items = 0;
+  usize nodes = 0;
+  usize literal_bytes = 0;
+  usize messages = 0;
+  usize visible = 0;
+  bool degraded = false;
+  bool truncated = false;
+  bool lint = false;
+  std::optional<usize> cut;
 
+  SeverityMask severities = ALL_SEVERITIES;
   MessageEmitter emitter;
+  DiagnosticHandler diagnostics;
   std::function<void(Node &&)> callback;
+  EventHandler events;
+  query::Index *lookup = nullptr;
+#ifdef BBCODE_STATS
+  ParseStats *stats = nullptr;
+#endif
 
  private:
-  void finish(Node&& node);
+  void push(Node &&node) {
+    BBCODE_STAT(this->stats,
+                stat.allocations += grows(this->stack, 1);
+                stat.max_depth = std::max(stat.max_depth, this->stack.size() + 1));
+    auto id = node.type >= 0 && node.type <= grammar::MAX_NODE ? grammar::tag_id(node.name) : grammar::NO_TAG;
+    if (id != grammar::NO_TAG) {
+      this->index(id, node.type, true);
+    }
+    if (this->events && node.type >= 0 && node.type <= grammar::MAX_NODE) {
+      this->enter(node);
+    }
+    this->ids.push_back(id);
+    this->stack.push_back(std::move(node));
+  }
+  /// Add or remove top of stack from the close tag index.
+  void index(usize id, NodeType type, bool push);
+  /// Empty node allocating from `resource`.
+  Node node(NodeType type, usize line, usize chr, usize offset, usize span) const {
+    return Node {
+        .type = type,
+        .name = std::pmr::string(this->resource),
+        .line = line,
+        .chr = chr,
+        .offset = offset,
+        .span = span,
+        .data = std::pmr::string(this->resource),
+        .children = std::pmr::vector<Node>(this->resource),
+    };
+  }
+  Node pop() {
+    auto node = std::move(this->stack.back());
+    if (this->ids.back() != grammar::NO_TAG) {
+      this->index(this->ids.back(), node.type, false);
+    }
+    this->ids.pop_back();
+    this->stack.pop_back();
+    return node;
+  }
+  void emit(const Diagnostic &diagnostic);
+  /// Validator messages, with `name` and `message` passed through as is.
+  void emit(const Message &message);
+  void report(const Diagnostic &diagnostic);
+  void enter(const Node &node);
+  bool misplaced(const Node &node) const;
+  /// `id` is the tag id of a tag node, as in `ids`.
+  void finish(Node&& node, usize id = grammar::NO_TAG);
   void finish_back();
-  void push_literal(std::string &&s);
-  void open_node(lexer::LexItem&& item);
-  void close_node(LexItem&& item);
+  void push_literal(std::string_view s);
+  void open_node(const LexView &item);
+  void close_node(const LexView &item);
   void push_node(Node&& node);
   void flush_state();
   void as_invalid(Node& node);
   void close();
+  bool too_deep(usize open) const {
+    return this->limits.max_depth && open >= this->limits.max_depth;
+  }
+  bool quiet() const {
+    return this->limits.max_messages && this->messages > this->limits.max_messages;
+  }
+  void keep_as_text(const LexView &item, std::string &&literal);
+  bool over_size(const LexView &item);
+  bool over_limit(const LexView &item);
+  void degrade(const LexView &item, MessageCode code);
+  void put_text(const LexView &item);
+  usize fit(std::string_view s, bool whole);
+  void step(const LexView &item);
  public:
-  Parser() : Parser([](const auto &&) {}, [](const auto &&) {}) {}
+  /// Without an emitter, so no message is built at all.
+  Parser() : Parser([](const auto &&) {}, [](const auto &&) {}) {
+    this->severities = 0;
+  }
+  /// Nodes are allocated from `resource`. The stack, tag name and parameter
+  /// buffers are kept across `reset` and stay on the default heap.
   template <class T1, class T2>
-  Parser(T1 callback, T2 emitter) :
-      stack{Node {
-        .type = NodeType::Literal,
-        .line = 0,
-        .chr = 0,
-        .offset = 0,
-        .span = 0
-      }},
+  Parser(T1 callback, T2 emitter,
+         std::pmr::memory_resource *resource = std::pmr::get_default_resource()) :
       state(Literal),
       before_tag(Literal),
+      resource(resource),
       emitter(emitter),
-      callback(callback) {}
+      callback(callback) {
+    this->stops.resize(grammar::tag_table().size());
+    this->push(this->node(NodeType::Literal, 0, 0, 0, 0));
+  }
   void put(LexItem &&item);
+  /// State the next item is read in. Done once End was put or the visible
+  /// limit was hit, after which input can stop.
+  ParserState current_state() const {
+    return this->state;
+  }
+  /// Offset of the first byte cut by `ParseLimits::max_visible`, if any.
+  std::optional<usize> preview_end() const {
+    return this->cut;
+  }
+  /// True right after a newline with no tag open. The rest of the input
+  /// then parses the same as a document of its own.
+  bool at_line_start() const {
+    return this->state == Literal && this->stack.size() == 1 &&
+        this->stack.back().type == grammar::Newline && !this->degraded && !this->truncated;
+  }
+  /// Same as `put(LexItem &&)` without taking ownership of the content.
+  void put(const LexView &item);
+  /// Attach stats to fill. No-op unless built with `BBCODE_STATS`.
+  void set_stats([[maybe_unused]] ParseStats *s) {
+#ifdef BBCODE_STATS
+    this->stats = s;
+#endif
+  }
+  /// Report nodes to `handler` as soon as they are known instead of building
+  /// the tree: tags on open and close, leaves when complete. Finished nodes
+  /// are not kept, so memory is bound by nesting depth and the current
+  /// text run. The node callback is not called. Kept across `reset`.
+  void set_events(EventHandler handler) {
+    this->events = std::move(handler);
+  }
+  /// Only report messages of the severities in `mask`. Others are skipped
+  /// before anything is formatted and do not count toward the message
+  /// limit. Kept across `reset`.
+  void set_severities(SeverityMask mask) {
+    this->severities = mask;
+  }
+  /// Report messages to `handler` unformatted instead of to the emitter.
+  /// Kept across `reset`.
+  void set_diagnostics(DiagnosticHandler handler) {
+    this->diagnostics = std::move(handler);
+  }
+  /// Also list finished tag nodes and constants in `index`, in any mode.
+  /// Kept across `reset`; clear the index between documents.
+  void set_index(query::Index *index) {
+    this->lookup = index;
+  }
+  /// Check the document without keeping it: text is not stored and the node
+  /// callback is not called. Messages and events are reported as usual,
+  /// text events without data. Memory is bound by nesting depth. Kept
+  /// across `reset`.
+  void set_lint(bool on) {
+    this->lint = on;
+  }
+  /// Limits apply from the next item on and are kept across `reset`.
+  void set_limits(const ParseLimits &l) {
+    this->limits = l;
+  }
+  /// Return to initial state for a new document, keeping allocated stack
+  /// and name/parameter buffers. Callbacks are kept.
+  void reset();
+  /// Like `reset`, and allocate nodes of the next document from `resource`.
+  /// Nothing allocated from the previous resource is kept.
+  void reset(std::pmr::memory_resource *resource);
 };
 
 }
@@ -0,0 +1,216 @@
+#include "pipeline.h"
+
+#include <thread>
+
+#include "writer.h"
+
+namespace bbcode::pipeline {
+
+using namespace bbcode::lexer;
+using namespace bbcode::parser;
+
+const char *STAGE_NAMES[STAGE_COUNT] = {"read", "lex", "parse", "render"};
+
+struct Chunk {
+  std::string data;
+  bool last = false;
+};
+
+/// `LexView` with the content, `length` bytes, packed in the batch text.
+struct Token {
+  LexType type;
+  u32 length;
+  usize line;
+  usize chr;
+  usize offset;
+};
+
+/// `Event` with name and data packed in the batch text.
+struct EventRecord {
+  EventType type;
+  NodeType node;
+  u32 name;
+  u32 data;
+  usize line;
+  usize chr;
+  usize offset;
+  usize span;
+};
+
+template<class R>
+struct Batch {
+  std::vector<R> records;
+  std::string text;
+  bool last = false;
+
+  void clear() {
+    this->records.clear();
+    this->text.clear();
+    this->last = false;
+  }
+};
+
+/// Fills batches of a ring, handing each over once it holds `size` records.
+template<class R>
+class Sender {
+ private:
+  Ring<Batch<R>> *ring;
+  StageStats *stats;
+  Batch<R> *batch;
+  usize size;
+
+ public:
+  Sender(Ring<Batch<R>> *ring, StageStats *stats, usize size)
+      : ring(ring), stats(stats), batch(&ring->back(stats)), size(size) {
+    this->batch->clear();
+  }
+  void add(const R &record, std::string_view first, std::string_view second = {}) {
+    this->batch->records.push_back(record);
+    this->batch->text.append(first);
+    this->batch->text.append(second);
+    if (this->batch->records.size() >= this->size) {
+      this->send();
+      this->batch = &this->ring->back(this->stats);
+      this->batch->clear();
+    }
+  }
+  void send(bool last = false) {
+    this->batch->last = last;
+    this->ring->push();
+    ++this->stats->batches;
+  }
+};
+
+/// Runs `f` as a stage, counting what is not idle time as busy.
+template<class F>
+static void run(StageStats *stats, F f) {
+  auto begin = std::chrono::steady_clock::now();
+  f();
+  std::chrono::duration<f64> elapsed = std::chrono::steady_clock::now() - begin;
+  stats->busy = elapsed.count() - stats->idle;
+}
+
+Result render_html(std::istream *input, std::ostream *output, const Options &options) {
+  Result result;
+  Ring<Chunk> chunks(options.ring_size);
+  Ring<Batch<Token>> tokens(options.ring_size);
+  Ring<Batch<EventRecord>> events(options.ring_size);
+  auto begin = std::chrono::steady_clock::now();
+
+  std::thread reader([&]() {
+    run(&result.stages[ReadStage], [&]() {
+      auto *stats = &result.stages[ReadStage];
+      bool last = false;
+      while (!last) {
+        auto &chunk = chunks.back(stats);
+        chunk.data.resize(options.chunk_size);
+        input->read(chunk.data.data(), isize(chunk.data.size()));
+        chunk.data.resize(usize(input->gcount()));
+        last = chunk.last = !*input;
+        chunks.push();
+        ++stats->batches;
+      }
+    });
+  });
+
+  std::thread lexer([&]() {
+    run(&result.stages[LexStage], [&]() {
+      auto *stats = &result.stages[LexStage];
+      Sender<Token> sender(&tokens, stats, options.batch_size);
+      ChunkLexer lexer([&sender](const LexView &item) {
+        sender.add(Token {
+            .type = item.type,
+            .length = u32(item.content.size()),
+            .line = item.line,
+            .chr = item.chr,
+            .offset = item.offset,
+        }, item.content);
+      });
+
+      bool last = false;
+      while (!last) {
+        auto &chunk = chunks.front(stats);
+        lexer.put(chunk.data);
+        last = chunk.last;
+        chunks.pop();
+      }
+      lexer.finish();
+      sender.send(true);
+    });
+  });
+
+  std::thread parser([&]() {
+    run(&result.stages[ParseStage], [&]() {
+      auto *stats = &result.stages[ParseStage];
+      Sender<EventRecord> sender(&events, stats, options.batch_size);
+      Parser parser([](Node &&) {}, [&result](Message &&message) {
+        result.messages.push_back(std::move(message));
+      });
+      parser.set_events([&sender](const Event &event) {
+        sender.add(EventRecord {
+            .type = event.type,
+            .node = event.node,
+            .name = u32(event.name.size()),
+            .data = u32(event.data.size()),
+            .line = event.line,
+            .chr = event.chr,
+            .offset = event.offset,
+            .span = event.span,
+        }, event.name, event.data);
+      });
+
+      bool last = false;
+      while (!last) {
+        auto &batch = tokens.front(stats);
+        std::string_view text = batch.text;
+        for (const auto &token : batch.records) {
+          parser.put(LexView {
+              .type = token.type,
+              .line = token.line,
+              .chr = token.chr,
+              .offset = token.offset,
+              .content = text.substr(0, token.length),
+          });
+          text.remove_prefix(token.length);
+        }
+        last = batch.last;
+        tokens.pop();
+      }
+      sender.send(true);
+    });
+  });
+
+  run(&result.stages[RenderStage], [&]() {
+    auto *stats = &result.stages[RenderStage];
+    writer::HtmlWriter writer(output);
+    bool last = false;
+    while (!last) {
+      auto &batch = events.front(stats);
+      std::string_view text = batch.text;
+      for (const auto &record : batch.records) {
+        writer(Event {
+            .type = record.type,
+            .node = record.node,
+            .name = text.substr(0, record.name),
+            .data = text.substr(record.name, record.data),
+            .line = record.line,
+            .chr = record.chr,
+            .offset = record.offset,
+            .span = record.span,
+        });
+        text.remove_prefix(record.name + record.data);
+      }
+      last = batch.last;
+      events.pop();
+    }
+  });
+
+  reader.join();
+  lexer.join();
+  parser.join();
+  std::chrono::duration<f64> elapsed = std::chrono::steady_clock::now() - begin;
+  result.seconds = elapsed.count();
+  return result;
+}
+
+}
@@ -0,0 +1,114 @@
+#ifndef BBCODE__PIPELINE_H_
+#define BBCODE__PIPELINE_H_
+
+#include <atomic>
+#include <chrono>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "parser.h"
+
+namespace bbcode::pipeline {
+
+/// Time a stage spent working and waiting on its neighbours.
+struct StageStats {
+  f64 busy = 0;
+  f64 idle = 0;
+  /// batches handed to the next stage
+  usize batches = 0;
+};
+
+/// Fixed ring of reused slots between one producer and one consumer thread.
+/// The producer fills `back()` in place and `push`es it; the consumer reads
+/// `front()` and `pop`s it. Either side waits while the ring is full or
+/// empty, counting the wait as idle time.
+template<class T>
+class Ring {
+ private:
+  std::vector<T> slots;
+  alignas(64) std::atomic<usize> head = 0;
+  alignas(64) std::atomic<usize> tail = 0;
+
+  static void wait(const std::atomic<usize> &value, usize old, StageStats *stats) {
+    auto begin = std::chrono::steady_clock::now();
+    while (value.load(std::memory_order_acquire) == old) {
+      value.wait(old, std::memory_order_acquire);
+    }
+    std::chrono::duration<f64> waited = std::chrono::steady_clock::now() - begin;
+    stats->idle += waited.count();
+  }
+
+ public:
+  explicit Ring(usize capacity) : slots(capacity) {}
+  T &back(StageStats *stats) {
+    auto tail = this->tail.load(std::memory_order_relaxed);
+    auto head = this->head.load(std::memory_order_acquire);
+    if (tail - head == this->slots.size()) {
+      wait(this->head, head, stats);
+    }
+    return this->slots[tail % this->slots.size()];
+  }
+  void push() {
+    this->tail.fetch_add(1, std::memory_order_release);
+    this->tail.notify_one();
+  }
+  T &front(StageStats *stats) {
+    auto head = this->head.load(std::memory_order_relaxed);
+    auto tail = this->tail.load(std::memory_order_acquire);
+    if (head == tail) {
+      wait(this->tail, tail, stats);
+    }
+    return this->slots[head % this->slots.size()];
+  }
+  void pop() {
+    this->head.fetch_add(1, std::memory_order_release);
+    this->head.notify_one();
+  }
+};
+
+enum Stage {
+  /// input stream to chunks
+  ReadStage = 0,
+  /// chunks to tokens, `ChunkLexer`
+  LexStage,
+  /// tokens to node events, `Parser::set_events`
+  ParseStage,
+  /// node events to HTML, `HtmlWriter`
+  RenderStage,
+};
+
+const usize STAGE_COUNT = RenderStage + 1;
+
+extern const char *STAGE_NAMES[STAGE_COUNT];
+
+struct Options {
+  /// bytes read at once
+  usize chunk_size = 1 << 16;
+  /// tokens or events handed over at once
+  usize batch_size = 1024;
+  /// batches in flight between two stages
+  usize ring_size = 8;
+};
+
+struct Result {
+  std::vector<Message> messages;
+  StageStats stages[STAGE_COUNT];
+  f64 seconds = 0;
+};
+
+/// Render `input` as HTML to `output`, the same as `Lexer` feeding `Parser`
+/// with `HtmlWriter` as its event handler, with reading, lexing, parsing and
+/// rendering each on a thread of its own.
+///
+/// Stages hand tokens and events over in batches, as fixed size records
+/// with their text packed behind them, through `Ring`s of `ring_size`
+/// batches. A stage ahead of a slower one waits once its ring is full, so
+/// memory stays bound. The stage with the least idle time is the
+/// bottleneck.
+Result render_html(std::istream *input, std::ostream *output, const Options &options = {});
+
+}
+
+#endif //BBCODE__PIPELINE_H_
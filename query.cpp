@@ -0,0 +1,66 @@
+#include "query.h"
+
+namespace bbcode::query {
+
+Index::Index() : tags(grammar::tag_table().size()) {}
+
+std::string_view Index::keep(std::string_view s) {
+  if (s.empty()) {
+    return {};
+  }
+  auto *data = static_cast<char *>(this->strings.allocate(s.size(), 1));
+  std::copy(s.begin(), s.end(), data);
+  return {data, s.size()};
+}
+
+void Index::add(usize id, grammar::NodeType type, std::string_view data,
+                usize line, usize chr, usize offset, usize span) {
+  std::vector<Entry> *list;
+  if (type == grammar::Constant) {
+    list = &this->found;
+  } else if (type >= 0 && type <= grammar::MAX_NODE && id != grammar::NO_TAG) {
+    list = &this->tags[id];
+  } else {
+    return;
+  }
+
+  list->push_back(Entry {
+      .type = type,
+      .line = line,
+      .chr = chr,
+      .offset = offset,
+      .span = span,
+      .data = type == grammar::Parametric || type == grammar::Constant ? this->keep(data) : std::string_view(),
+  });
+}
+
+std::span<const Entry> Index::tag(usize id) const {
+  if (id >= this->tags.size()) {
+    return {};
+  }
+  return this->tags[id];
+}
+
+std::span<const Entry> Index::tag(std::string_view name) const {
+  return this->tag(grammar::tag_id(name));
+}
+
+std::vector<std::string_view> Index::parameters(std::string_view name) const {
+  std::vector<std::string_view> result;
+  for (const auto &entry : this->tag(name)) {
+    if (entry.type == grammar::Parametric) {
+      result.push_back(entry.data);
+    }
+  }
+  return result;
+}
+
+void Index::clear() {
+  for (auto &list : this->tags) {
+    list.clear();
+  }
+  this->found.clear();
+  this->strings.release();
+}
+
+}
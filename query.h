@@ -0,0 +1,64 @@
+#ifndef BBCODE__QUERY_H_
+#define BBCODE__QUERY_H_
+
+#include <string_view>
+#include <vector>
+#include <span>
+#include <memory_resource>
+
+#include "grammar.h"
+
+namespace bbcode::query {
+
+/// Tag node or constant found by the parser. The node is found in the tree
+/// by `offset`. `data` is the parameter of a Parametric node and the text
+/// of a constant, valid until the index is cleared.
+struct Entry {
+  grammar::NodeType type;
+  usize line;
+  usize chr;
+  usize offset;
+  usize span;
+  std::string_view data;
+};
+
+/// Nodes of a document by tag id, and its constants, filled by
+/// `Parser::set_index`. Finding every link is then a scan of one list
+/// instead of a walk of the tree. Nodes are listed in the order they are
+/// finished, so nested ones come before the node holding them. Invalid
+/// nodes are not listed.
+class Index {
+ private:
+  std::vector<std::vector<Entry>> tags;
+  std::vector<Entry> found;
+  std::pmr::monotonic_buffer_resource strings;
+
+  std::string_view keep(std::string_view s);
+
+ public:
+  Index();
+  Index(const Index &) = delete;
+  Index &operator=(const Index &) = delete;
+
+  /// Called by the parser for each finished node, with the tag id of tag
+  /// nodes and `NO_TAG` for others.
+  void add(usize id, grammar::NodeType type, std::string_view data,
+           usize line, usize chr, usize offset, usize span);
+
+  /// Nodes of tag `id`, see `grammar::tag_id`.
+  std::span<const Entry> tag(usize id) const;
+  /// Nodes of tag `name`, empty for an unknown name.
+  std::span<const Entry> tag(std::string_view name) const;
+  std::span<const Entry> constants() const {
+    return this->found;
+  }
+  /// Parameters of the Parametric nodes of tag `name`, e.g. every link.
+  std::vector<std::string_view> parameters(std::string_view name) const;
+
+  /// Forget all entries for the next document, keeping list capacity.
+  void clear();
+};
+
+}
+
+#endif //BBCODE__QUERY_H_
@@ -0,0 +1,45 @@
+#include "stats.h"
+
+namespace bbcode {
+
+static const char *TOKEN_NAMES[] = {
+    "Newline", "OpenTagLeft", "CloseTagLeft", "TagRight", "Equal", "Constant",
+    "Literal", "End",
+};
+
+static const char *NODE_NAMES[] = {
+    "Invalid", "Omission", "Simple", "Parametric", "Greedy", "Verbatim",
+    "Literal", "Constant", "Newline", "End",
+};
+
+static const char *SEVERITY_NAMES[] = {"Tidy", "Warning", "Error"};
+
+template<class T, usize N>
+static void write_counts(const std::array<usize, N> &counts, const T &names, std::ostream *o) {
+  *o << "{";
+  for (usize i = 0; i < N; ++i) {
+    *o << "\"" << names[i] << "\":" << counts[i];
+    if (i + 1 != N) {
+      *o << ",";
+    }
+  }
+  *o << "}";
+}
+
+void write_stats(const ParseStats &stats, std::ostream *o) {
+  *o << R"({"bytes":)" << stats.bytes << R"(,"tokens":)";
+  write_counts(stats.tokens, TOKEN_NAMES, o);
+  *o << R"(,"trie_walks":)" << stats.trie_walks << R"(,"nodes":)";
+  write_counts(stats.nodes, NODE_NAMES, o);
+  *o << R"(,"validator_calls":)" << stats.validator_calls
+     << R"(,"validator_ns":)" << stats.validator_ns
+     << R"(,"close_tags":)" << stats.close_tags
+     << R"(,"close_recoveries":)" << stats.close_recoveries
+     << R"(,"close_ns":)" << stats.close_ns << R"(,"messages":)";
+  write_counts(stats.messages, SEVERITY_NAMES, o);
+  *o << R"(,"max_depth":)" << stats.max_depth
+     << R"(,"literal_bytes":)" << stats.literal_bytes
+     << R"(,"allocations":)" << stats.allocations << "}";
+}
+
+}
@@ -0,0 +1,90 @@
+#ifndef BBCODE__STATS_H_
+#define BBCODE__STATS_H_
+
+#include <array>
+#include <chrono>
+#include <ostream>
+
+#include "defs.h"
+
+namespace bbcode {
+
+/// Per document counters filled by `Lexer` and `Parser`.
+///
+/// Only collected when built with `BBCODE_STATS`, otherwise every counting
+/// site compiles to nothing and the struct is left untouched.
+struct ParseStats {
+  /// bytes put into lexer
+  usize bytes = 0;
+
+  /// tokens emitted per `LexType`
+  std::array<usize, 8> tokens {};
+
+  /// trie steps walked looking for constants
+  usize trie_walks = 0;
+
+  /// finished nodes per `NodeType`, indexed by type + 1
+  std::array<usize, 10> nodes {};
+
+  usize validator_calls = 0;
+  u64 validator_ns = 0;
+
+  /// close tags handled, nodes closed implicitly by them, and time spent
+  usize close_tags = 0;
+  usize close_recoveries = 0;
+  u64 close_ns = 0;
+
+  /// messages per `Severity`
+  std::array<usize, 3> messages {};
+
+  usize max_depth = 0;
+
+  /// bytes copied into token, literal, name and parameter strings
+  usize literal_bytes = 0;
+
+  /// string and container growths that had to allocate
+  usize allocations = 0;
+};
+
+/// Write stats as JSON object.
+void write_stats(const ParseStats &stats, std::ostream *o);
+
+/// Whether adding `n` elements to `c` has to allocate.
+template<class C>
+inline bool grows(const C &c, usize n) {
+  return c.size() + n > c.capacity();
+}
+
+class StatTimer {
+ private:
+  ParseStats *stats;
+  u64 ParseStats::*field;
+  std::chrono::steady_clock::time_point begin;
+
+ public:
+  StatTimer(ParseStats *stats, u64 ParseStats::*field)
+      : stats(stats), field(field), begin(std::chrono::steady_clock::now()) {}
+  ~StatTimer() {
+    if (this->stats) {
+      auto elapsed = std::chrono::steady_clock::now() - this->begin;
+      this->stats->*this->field += u64(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+    }
+  }
+};
+
+}
+
+#ifdef BBCODE_STATS
+/// Run statements with `stat` bound to stats, if stats are attached.
+#define BBCODE_STAT(stats, ...) do { \
+  if (auto *stats_ptr_ = (stats)) { auto &stat = *stats_ptr_; __VA_ARGS__; } \
+} while (false)
+/// Add time until end of scope to stats field.
+#define BBCODE_STAT_TIMER(stats, field) \
+  ::bbcode::StatTimer stat_timer_##field((stats), &::bbcode::ParseStats::field)
+#else
+#define BBCODE_STAT(stats, ...) do {} while (false)
+#define BBCODE_STAT_TIMER(stats, field) do {} while (false)
+#endif
+
+#endif //BBCODE__STATS_H_
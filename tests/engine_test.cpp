@@ -0,0 +1,73 @@
+#include "engine.h"
+#include "fixtures.h"
+#include <cassert>
+
+using namespace bbcode::parser;
+using namespace bbcode::engine;
+using namespace bbcode::test;
+
+/// feed in chunks of `chunk` bytes, to cross pending "[" and text
+std::string fused(const std::string &input, const ParseLimits &limits, usize chunk) {
+  Parsed parsed;
+  Engine engine([&parsed](Node &&node) {
+    if (node.type != bbcode::grammar::End) {
+      parsed.nodes.push_back(std::move(node));
+    }
+  }, [&parsed](Message &&message) {
+    parsed.messages.push_back(std::move(message));
+  });
+  engine.set_limits(limits);
+
+  for (usize i = 0; i < input.size(); i += chunk) {
+    engine.put(std::string_view(input).substr(i, chunk));
+  }
+  engine.finish();
+  return dump(parsed.nodes, parsed.messages);
+}
+
+std::string plain(const std::string &input, const ParseLimits &limits) {
+  auto parsed = two_stage(input, limits);
+  return dump(parsed.nodes, parsed.messages);
+}
+
+int main() {
+  const char *cases[] = {
+      "",
+      "[",
+      "plain text",
+      "[b]bold[/b] and [i]italic",
+      "a]b=c[b=1]x[/b]",
+      "[url=http://a.b/?x=1]link[/url]",
+      "[code]a[b]=c]:)[/cod[/code]",
+      "[:)]:)=:)]:)",
+      "[list][*]a[*]b[/list]",
+      "[color=red=blue]x[/color]\n[b\n]",
+  };
+
+  for (auto input : cases) {
+    auto expected = plain(input, {});
+    assert(fused(input, {}, 1 << 20) == expected);
+    assert(fused(input, {}, 1) == expected);
+  }
+
+  /// random tag soup, also under limits
+  const ParseLimits limits[] = {
+      {},
+      {.max_depth = 3},
+      {.max_nodes = 20},
+      {.max_literal_bytes = 40},
+      {.max_messages = 2},
+      {.max_visible = 30},
+  };
+
+  Random next(1);
+  for (usize round = 0; round < 2000; ++round) {
+    auto input = soup(next, next(40));
+    const auto &limit = limits[round % std::size(limits)];
+    auto expected = plain(input, limit);
+    assert(fused(input, limit, 1 << 20) == expected);
+    assert(fused(input, limit, 1 + next(5)) == expected);
+  }
+
+  return 0;
+}
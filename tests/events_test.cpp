@@ -0,0 +1,108 @@
+#include "fixtures.h"
+#include <cassert>
+
+using namespace bbcode::lexer;
+using namespace bbcode::parser;
+using namespace bbcode::writer;
+using namespace bbcode::test;
+
+/// nodes and messages, then the HTML
+std::string tree(const std::string &input) {
+  auto parsed = two_stage(input);
+  std::stringstream html;
+  for (const auto &node : parsed.nodes) {
+    write_html(node, &html);
+  }
+  return dump(parsed.nodes, parsed.messages) + '\n' + html.str();
+}
+
+/// rebuild the tree from events, and render them as they come
+std::string events(const std::string &input) {
+  Parsed parsed;
+  std::stringstream html;
+  HtmlWriter writer(&html);
+  std::vector<Node> open;
+  usize max_open = 0;
+
+  auto add = [&](Node &&node) {
+    if (open.empty()) {
+      parsed.nodes.push_back(std::move(node));
+    } else {
+      open.back().children.push_back(std::move(node));
+    }
+  };
+
+  Parser parser([](Node &&) {
+    assert(false);
+  }, [&parsed](Message &&message) {
+    parsed.messages.push_back(std::move(message));
+  });
+  parser.set_events([&](const Event &event) {
+    writer(event);
+    auto node = Node {
+        .type = event.node,
+        .name = std::pmr::string(event.name),
+        .line = event.line,
+        .chr = event.chr,
+        .offset = event.offset,
+        .span = event.span,
+        .data = std::pmr::string(event.data),
+    };
+    switch (event.type) {
+      case Enter:
+        open.push_back(std::move(node));
+        max_open = std::max(max_open, open.size());
+        break;
+      case Leave: {
+        auto back = std::move(open.back());
+        open.pop_back();
+        assert(back.type == event.node && back.name == event.name);
+        back.span = event.span;
+        add(std::move(back));
+        break;
+      }
+      case Leaf:
+        add(std::move(node));
+        break;
+      case Finish:
+        assert(open.empty());
+        break;
+    }
+  });
+  Lexer lexer([&parser](LexItem &&item) {
+    parser.put(std::move(item));
+  });
+  lexer.put(input);
+  lexer.finish();
+
+  // only open tags are held
+  assert(max_open <= usize(std::count(input.begin(), input.end(), '[')));
+  return dump(parsed.nodes, parsed.messages) + '\n' + html.str();
+}
+
+int main() {
+  const char *cases[] = {
+      "",
+      "text\n[b]bold [i]both[/i][/b]",
+      "[code]a\n[b]c[/code]",
+      "[list][*]a[*]b\n[/list]",
+      "[list]a[*]b[/list]",
+      "[*]top level item",
+      "[table][tr]x[td]a[/td][/tr][/table]",
+      "[b][size=3][color=red]unclosed",
+      "[tr][color=red]x[/color][/tr]",
+  };
+
+  for (auto input : cases) {
+    auto expected = tree(input);
+    assert(events(input) == expected);
+  }
+
+  Random next(7);
+  for (usize round = 0; round < 2000; ++round) {
+    auto input = soup(next, next(40));
+    assert(events(input) == tree(input));
+  }
+
+  return 0;
+}
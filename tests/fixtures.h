@@ -0,0 +1,98 @@
+#ifndef BBCODE_TESTS__FIXTURES_H_
+#define BBCODE_TESTS__FIXTURES_H_
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "writer.h"
+
+/// Shared by the tests that check a way of parsing against the plain one on
+/// random tag soup.
+namespace bbcode::test {
+
+using parser::Node;
+using parser::ParseLimits;
+
+/// Deterministic, so a failing round reproduces.
+class Random {
+ private:
+  u64 seed;
+
+ public:
+  explicit Random(u64 seed) : seed(seed) {}
+  /// Uniform in [0, n).
+  usize operator()(usize n) {
+    this->seed = this->seed * 6364136223846793005ull + 1442695040888963407ull;
+    return usize(this->seed >> 33) % n;
+  }
+};
+
+/// Text, constants, tag characters and known tags, whole and in parts, with
+/// good and bad parameters and in places they are not allowed.
+inline const char *const PIECES[] = {
+    "\n", "\n", "\n", "\n", " ", "a", "text", "<&>", ":)", ":(", ":", ")", "=:)", "]:)",
+    "[", "]", "[/", "=", "[[", "]]", "b", "url", "*", "td", "http://x.y", "12", "[foo]",
+    "[b]", "[/b]", "[i]", "[/i]", "[code]", "[/code]", "[list]", "[list=1]", "[/list]", "[*]",
+    "[hr]", "[quote]", "[quote=a=b]", "[/quote]", "[url=", "[url=http://x.y]", "[url=http://c.d/e]",
+    "[url=javascript:x]", "[/url]", "[color=red]", "[color=RED]", "[/color]", "[size=3]",
+    "[size=3PX]", "[/size]", "[font=' a ',b]", "[font=\"Times New Roman\"]", "[/font]",
+    "[table]", "[/table]", "[tr]", "[/tr]", "[td]", "[/td]",
+};
+
+/// `pieces` random pieces.
+inline std::string soup(Random &next, usize pieces) {
+  std::string text;
+  for (usize i = 0; i < pieces; ++i) {
+    text += PIECES[next(std::size(PIECES))];
+  }
+  return text;
+}
+
+/// A line per message with everything it holds.
+inline std::string describe(const std::vector<Message> &messages) {
+  std::stringstream ss;
+  for (const auto &message : messages) {
+    ss << '\n' << message.severity << ' ' << message.line << ':' << message.chr << ' '
+       << message.offset << '+' << message.span << ' ' << message.name << ' ' << message.message;
+  }
+  return ss.str();
+}
+
+/// Nodes as JSON followed by the messages, to compare results as strings.
+inline std::string dump(const std::vector<Node> &nodes, const std::vector<Message> &messages) {
+  std::stringstream ss;
+  for (const auto &node : nodes) {
+    writer::write_json(node, &ss);
+  }
+  return ss.str() + describe(messages);
+}
+
+struct Parsed {
+  /// top-level nodes, without End
+  std::vector<Node> nodes;
+  std::vector<Message> messages;
+};
+
+/// The plain way: `Lexer` feeding `Parser`.
+inline Parsed two_stage(std::string_view text, const ParseLimits &limits = {}) {
+  Parsed parsed;
+  parser::Parser parser([&parsed](Node &&node) {
+    if (node.type != grammar::End) {
+      parsed.nodes.push_back(std::move(node));
+    }
+  }, [&parsed](Message &&message) {
+    parsed.messages.push_back(std::move(message));
+  });
+  parser.set_limits(limits);
+  lexer::Lexer lexer([&parser](lexer::LexItem &&item) {
+    parser.put(std::move(item));
+  });
+  lexer.put(text);
+  lexer.finish();
+  return parsed;
+}
+
+}
+
+#endif //BBCODE_TESTS__FIXTURES_H_
@@ -0,0 +1,146 @@
+#include "generator.h"
+#include "writer.h"
+#include <sstream>
+#include <cassert>
+
+using namespace bbcode::lexer;
+using namespace bbcode::parser;
+using namespace bbcode::writer;
+using namespace bbcode::generator;
+
+/// Counts bytes outstanding from the default heap.
+class Counting : public std::pmr::memory_resource {
+ public:
+  usize allocated = 0;
+  usize outstanding = 0;
+
+ private:
+  void *do_allocate(usize bytes, usize alignment) override {
+    ++this->allocated;
+    this->outstanding += bytes;
+    return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+  }
+  void do_deallocate(void *p, usize bytes, usize alignment) override {
+    this->outstanding -= bytes;
+    std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+  }
+  bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+    return this == &other;
+  }
+};
+
+std::string describe(const LexItem &item) {
+  std::stringstream ss;
+  ss << item.type << ' ' << item.line << ':' << item.chr << ' ' << item.offset;
+  if (item.type == Constant) {
+    ss << ' ' << std::get<Constant>(item.d).content;
+  } else if (item.type == bbcode::lexer::Literal) {
+    ss << ' ' << std::get<bbcode::lexer::Literal>(item.d).content;
+  }
+  return ss.str() + '\n';
+}
+
+std::string describe(const LexView &item) {
+  std::stringstream ss;
+  ss << item.type << ' ' << item.line << ':' << item.chr << ' ' << item.offset;
+  if (item.type == Constant || item.type == bbcode::lexer::Literal) {
+    ss << ' ' << item.content;
+  }
+  return ss.str() + '\n';
+}
+
+std::string describe(const Node &node) {
+  std::stringstream ss;
+  write_json(node, &ss);
+  return ss.str();
+}
+
+int main() {
+  /// same tokens and nodes as the callbacks
+  const char *inputs[] = {
+      "",
+      "text",
+      "[b]bold[/b] :) [i]open\n[url=http://x.y]link[/url]\n",
+      "[code][b]x[/b]\n[/code][color=RED]c[/color]\n[/b][size=3PX]",
+      "[[/]=]]:):(\n\n[list][*]a[*]b[/list][hr]",
+  };
+  for (auto input : inputs) {
+    std::string tokens_pushed, tokens_pulled;
+    Lexer lexer([&tokens_pushed](LexItem &&item) {
+      tokens_pushed += describe(item);
+    });
+    lexer.put(input);
+    lexer.finish();
+    for (auto &item : tokens(input)) {
+      tokens_pulled += describe(item);
+    }
+    assert(tokens_pulled == tokens_pushed);
+
+    std::string nodes_pushed, nodes_pulled;
+    Parser parser([&nodes_pushed](Node &&node) {
+      if (node.type != bbcode::grammar::End) {
+        nodes_pushed += describe(node);
+      }
+    }, [](Message &&) {});
+    Lexer feeder([&parser](LexItem &&item) {
+      parser.put(std::move(item));
+    });
+    feeder.put(input);
+    feeder.finish();
+    for (auto &node : nodes(input)) {
+      nodes_pulled += describe(node);
+    }
+    assert(nodes_pulled == nodes_pushed);
+  }
+
+  /// frame and nodes come from the arena, work stops with the consumer
+  std::string text;
+  for (usize i = 0; i < 10000; ++i) {
+    text += "line [b]bold[/b] :)\n";
+  }
+
+  /// tokens running across block ends are copied, not left dangling
+  std::string tokens_pushed, tokens_pulled;
+  Lexer lexer([&tokens_pushed](LexItem &&item) {
+    tokens_pushed += describe(item);
+  });
+  lexer.put(text);
+  lexer.finish();
+  for (auto &item : tokens(text)) {
+    tokens_pulled += describe(item);
+  }
+  assert(tokens_pulled == tokens_pushed);
+
+  std::string expected;
+  for (auto &node : nodes(text)) {
+    expected += describe(node);
+    if (expected.size() > 100) {
+      break;
+    }
+  }
+  Counting arena;
+  {
+    auto gen = nodes(std::allocator_arg, &arena, text);
+    assert(arena.allocated == 1);
+    std::string first;
+    for (auto &node : gen) {
+      first += describe(node);
+      if (first.size() > 100) {
+        break;
+      }
+    }
+    assert(first == expected);
+    assert(arena.allocated < 20);
+  }
+  assert(arena.outstanding == 0);
+
+  /// moved generators keep their position
+  auto gen = tokens(std::allocator_arg, &arena, "a[b]");
+  auto it = gen.begin();
+  auto moved = std::move(gen);
+  assert(it->type == bbcode::lexer::Literal);
+  ++it;
+  assert(it->type == OpenTagLeft);
+
+  return 0;
+}
@@ -0,0 +1,58 @@
+#include "incremental.h"
+#include "fixtures.h"
+#include <cassert>
+
+using namespace bbcode::incremental;
+using namespace bbcode::test;
+
+std::string dump(const Document &document) {
+  return dump(document.get_nodes(), document.get_messages());
+}
+
+int main() {
+  Random next(3);
+
+  /// edits give the same result as parsing the new text
+  for (usize round = 0; round < 150; ++round) {
+    Document document(soup(next, next(60)));
+    for (usize i = 0; i < 20; ++i) {
+      const auto &text = document.get_text();
+      auto offset = next(text.size() + 1);
+      auto removed = next(std::min<usize>(text.size() - offset, 8) + 1);
+      document.edit(offset, removed, soup(next, next(3)));
+      assert(dump(document) == dump(Document(document.get_text())));
+    }
+  }
+
+  /// typing in a line of a long document only parses near that line
+  std::string text;
+  for (usize i = 0; i < 1000; ++i) {
+    text += "line [b]bold[/b] :)\n";
+  }
+  Document document(text);
+  std::vector<const Node *> storage;
+  for (const auto &segment : document.get_segments()) {
+    storage.push_back(segment.nodes.data());
+  }
+  usize parsed = 0;
+  for (auto c : std::string_view("typed text :)")) {
+    parsed += document.edit(10000, 0, std::string(1, c));
+  }
+  assert(parsed < 1000);
+  assert(dump(document) == dump(Document(document.get_text())));
+
+  /// and leaves the nodes of the other lines where they were
+  const auto &segments = document.get_segments();
+  assert(segments.size() == storage.size());
+  usize rebuilt = 0;
+  for (usize i = 0; i < segments.size(); ++i) {
+    rebuilt += segments[i].nodes.data() != storage[i];
+  }
+  assert(rebuilt == 1);
+
+  /// an unclosed tag ripples to the end
+  assert(document.edit(0, 0, "[b]") == document.get_text().size());
+  assert(dump(document) == dump(Document(document.get_text())));
+
+  return 0;
+}
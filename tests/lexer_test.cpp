@@ -4,6 +4,7 @@
 
 #include "lexer.h"
 #include <vector>
+#include <sstream>
 #include <cassert>
 
 using namespace bbcode::lexer;
@@ -23,6 +24,36 @@ std::vector<LexItem> get_output(const std::string& input) {
   return items;
 }
 
+std::string describe(LexType type, usize line, usize chr, usize offset, std::string_view content) {
+  std::stringstream ss;
+  ss << type << ' ' << line << ':' << chr << ' ' << offset << ' ' << content << '\n';
+  return ss.str();
+}
+
+/// all items of Lexer, and of ChunkLexer fed in chunks of `sizes` in turn
+std::pair<std::string, std::string> compare_chunked(const std::string& input, const std::vector<usize>& sizes) {
+  std::string expected;
+  for (const auto& item : get_output(input)) {
+    std::string_view content;
+    if (item.type == Literal || item.type == Constant) {
+      content = item.type == Literal ? std::get<Literal>(item.d).content : std::get<Constant>(item.d).content;
+    }
+    expected += describe(item.type, item.line, item.chr, item.offset, content);
+  }
+
+  std::string actual;
+  ChunkLexer lexer([&actual](const LexView& item) {
+    actual += describe(item.type, item.line, item.chr, item.offset, item.content);
+  });
+
+  for (usize i = 0, n = 0; i < input.size(); i += sizes[n++ % sizes.size()]) {
+    lexer.put(std::string_view(input).substr(i, sizes[n % sizes.size()]));
+  }
+
+  lexer.finish();
+  return {expected, actual};
+}
+
 int main() {
   /// standalone literal
   auto result1 = get_output("test");
@@ -57,5 +88,40 @@ int main() {
   assert(result3[10].type == Newline);
   assert(result3[11].type == End);
 
+  /// constant prefix broken by tag character
+  auto result4 = get_output(":])\n:\n)");
+  assert(result4.size() == 8);
+  assert(result4[2].type == Literal);
+  assert(std::get<Literal>(result4[2].d).content == ")");
+
+  /// reused lexer
+  std::vector<LexItem> items;
+  Lexer lexer([&items](LexItem&& item) {
+    items.push_back(item);
+  });
+
+  for (const auto& c : std::string("[b]:")) {
+    lexer.put(c);
+  }
+
+  lexer.reset();
+  items.clear();
+  for (const auto& c : std::string(")x")) {
+    lexer.put(c);
+  }
+
+  lexer.finish();
+  assert(items.size() == 2);
+  assert(items[0].type == Literal);
+  assert(std::get<Literal>(items[0].d).content == ")x");
+  assert(items[0].chr == 0);
+
+  /// chunked input gives the same items, wherever the chunks end
+  const std::string chunked = "[size=1]hello :)[/size]\n:])\n:\n)[b]x:-)y[/b]:(";
+  for (const auto& sizes : std::vector<std::vector<usize>> {{1}, {2}, {3}, {1, 4}, {5, 2, 1}, {1000}}) {
+    auto [expected, actual] = compare_chunked(chunked, sizes);
+    assert(expected == actual);
+  }
+
   return 0;
 }
\ No newline at end of file
@@ -0,0 +1,135 @@
+#include "writer.h"
+#include <sstream>
+#include <vector>
+#include <cassert>
+
+using namespace bbcode::lexer;
+using namespace bbcode::parser;
+using namespace bbcode::writer;
+
+struct Result {
+  std::string output;
+  std::vector<std::string> messages;
+
+  bool has(const std::string &name) const {
+    for (const auto &message : this->messages) {
+      if (message == name) {
+        return true;
+      }
+    }
+    return false;
+  }
+};
+
+Result tidy(const std::string& input, const ParseLimits &limits, usize *cut = nullptr,
+           SeverityMask severities = ALL_SEVERITIES) {
+  Result result;
+  std::stringstream ss;
+
+  Parser parser(Writer(&ss), [&result](Message&& message) {
+    result.messages.push_back(message.name);
+  });
+  parser.set_limits(limits);
+  parser.set_severities(severities);
+  Lexer lexer([&parser](LexItem&& item) {
+    parser.put(std::move(item));
+  });
+
+  for (auto c : input) {
+    if (parser.current_state() == Done) {
+      break;
+    }
+    lexer.put(static_cast<i8>(c));
+  }
+  lexer.finish();
+  result.output = ss.str();
+  if (cut) {
+    *cut = parser.preview_end().value_or(input.size());
+  }
+  return result;
+}
+
+int main() {
+  /// tags past max depth are text
+  auto result1 = tidy("[b][i][x]a[/x][/i][/b]", ParseLimits {.max_depth = 2});
+  assert(result1.output == "[b][i][x]a[/i][/b]");
+  assert(result1.has("depth-limit"));
+  auto result2 = tidy("[b][size=1][color=red]a", ParseLimits {.max_depth = 2});
+  assert(result2.output == "[b][size=1][color=red]a[/size][/b]");
+
+  /// omission and sibling greedy tags don't nest
+  auto result3 = tidy("[list][*]a[*]b[hr][/list]", ParseLimits {.max_depth = 2});
+  assert(result3.output == "[list][*]a[*]b[hr][/list]");
+  assert(!result3.has("depth-limit"));
+
+  /// past max nodes the rest is text
+  auto result4 = tidy("a[b]b[/b]\n[i]c[/i]", ParseLimits {.max_nodes = 2});
+  assert(result4.output == "a[b]b[/b]\n[i]c[/i]");
+  assert(result4.has("node-limit"));
+
+  /// past max literal bytes the rest is dropped
+  auto result5 = tidy("[b]hello[/b] world", ParseLimits {.max_literal_bytes = 8});
+  assert(result5.output == "[b]hello[/b]");
+  assert(result5.has("size-limit"));
+
+  /// messages past limit are dropped, with one note
+  auto result6 = tidy("[b][b][b][b][b][b]", ParseLimits {.max_messages = 3});
+  assert(result6.messages.size() == 4);
+  assert(result6.messages.back() == "message-limit");
+
+  /// cancellation and deadline are checked every few items
+  std::atomic<bool> cancel = true;
+  auto result7 = tidy(std::string(ParseLimits::CHECK_INTERVAL, '\n') + "[b]x[/b]",
+                      ParseLimits {.cancel = &cancel});
+  assert(result7.output == std::string(ParseLimits::CHECK_INTERVAL, '\n') + "[b]x[/b]");
+  assert(result7.has("cancelled"));
+  auto result8 = tidy(std::string(ParseLimits::CHECK_INTERVAL, '\n') + "[b]x",
+                      ParseLimits {.deadline = std::chrono::steady_clock::now()});
+  assert(result8.has("time-limit"));
+
+  /// close tags match at most close_window levels up, 0 for any
+  std::string deep = "[i]";
+  for (usize i = 0; i < 8; ++i) {
+    deep += "[b]";
+  }
+  deep += "x[/i]";
+  assert(tidy(deep, ParseLimits {}).has("unpaired-close-tag"));
+  assert(!tidy(deep, ParseLimits {.close_window = 9}).has("unpaired-close-tag"));
+  assert(!tidy(deep, ParseLimits {.close_window = 0}).has("unpaired-close-tag"));
+
+  /// greedy nodes stop close tags they are not terminated by
+  assert(tidy("[list][*]a[/list]", ParseLimits {.close_window = 0}).output == "[list][*]a[/list]");
+  assert(tidy("[b][list][*]a[/b]", ParseLimits {.close_window = 0}).output == "[b][list][*]a[/list][/b]");
+
+  /// past max visible characters the text is cut, open tags closed quietly
+  usize cut;
+  auto result10 = tidy("[b]hello[/b] [i]world[/i] :) more", ParseLimits {.max_visible = 8}, &cut);
+  assert(result10.output == "[b]hello[/b] [i]wo[/i]");
+  assert(result10.messages.empty());
+  assert(cut == 18);
+  tidy("[b]hello[/b]\n:) more", ParseLimits {.max_visible = 5}, &cut);
+  assert(cut == 12);
+  assert(tidy("[b]hello[/b]\n:) more", ParseLimits {.max_visible = 7}, &cut).output == "[b]hello[/b]\n:)");
+  assert(cut == 15);
+  assert(tidy("h\xc3\xa9llo", ParseLimits {.max_visible = 2}, &cut).output == "h\xc3\xa9");
+  assert(cut == 3);
+  assert(tidy("[b]hi[/b]", ParseLimits {.max_visible = 2}, &cut).output == "[b]hi[/b]");
+  assert(cut == 9);
+
+  /// masked severities are not reported and don't count toward the limit
+  auto result11 = tidy("[foo][foo][b]a", ParseLimits {.max_messages = 1}, nullptr, severity_bit(Warning));
+  assert(result11.output == "[foo][foo][b]a[/b]");
+  assert(result11.messages == std::vector<std::string> {"missing-close-tag"});
+  assert(tidy("[foo][foo][b]a", ParseLimits {}, nullptr, 0).messages.empty());
+
+  /// text is formatted from the code only when asked for
+  auto message = to_message(Diagnostic {.severity = Error, .code = BadParameter, .subject = "1x", .tag = "size"});
+  assert(message.name == "bad-parameter");
+  assert(message.message == "`1x` is not valid parameter of size tag. This tag will be decayed to normal text.");
+
+  /// limits are per document
+  auto result9 = tidy("[b]x[/b]", ParseLimits {.max_nodes = 3});
+  assert(result9.messages.empty());
+
+  return 0;
+}
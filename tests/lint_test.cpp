@@ -0,0 +1,29 @@
+#include "lint.h"
+#include "fixtures.h"
+#include <cassert>
+
+using namespace bbcode::parser;
+using namespace bbcode::test;
+
+int main() {
+  /// counts and messages of a document
+  auto result = bbcode::lint::check("[b]bold[/i]\n[foo]x[size=huge]y[/size]");
+  assert(result.errors == 1 && result.warnings == 3 && result.notes == 1);
+  assert(result.messages.size() == 5);
+  assert(!result.clean());
+  assert(bbcode::lint::check("[b]x[/b] :)").clean());
+
+  /// limits apply as in a full parse
+  result = bbcode::lint::check("[b][b][b][b]", ParseLimits {.max_messages = 2});
+  assert(result.messages.size() == 3);
+  assert(result.messages.back().name == "message-limit");
+
+  /// same messages as the full parse
+  Random next(7);
+  for (usize round = 0; round < 500; ++round) {
+    auto text = soup(next, next(80));
+    assert(describe(bbcode::lint::check(text).messages) == describe(two_stage(text).messages));
+  }
+
+  return 0;
+}
@@ -0,0 +1,54 @@
+#include "writer.h"
+#include <sstream>
+#include <cassert>
+
+using namespace bbcode::lexer;
+using namespace bbcode::parser;
+using namespace bbcode::writer;
+
+void parse(const std::string &input, MessageDigest *digest) {
+  std::stringstream ss;
+  Parser parser(Writer(&ss), [](Message &&) {});
+  parser.set_diagnostics(digest->handler());
+  Lexer lexer([&parser](LexItem &&item) {
+    parser.put(std::move(item));
+  });
+  lexer.put(input);
+  lexer.finish();
+}
+
+int main() {
+  /// repeated messages of a name and tag fold into one
+  MessageDigest digest;
+  parse("[foo]a[foo]b[bar]\n[foo]", &digest);
+  assert(digest.messages().size() == 2);
+  [[maybe_unused]] const auto &foo = digest.messages()[0];
+  assert(foo.first.name == "unknown-open-tag");
+  assert(foo.first.message == "Unknown open tag `foo` interpreted as normal text.");
+  assert(foo.count == 3);
+  assert(foo.first.offset == 0 && foo.last_offset == 18);
+  assert(foo.last_line == 1 && foo.last_chr == 0);
+  assert(digest.messages()[1].count == 1);
+  assert(digest.count(Tidy) == 4 && digest.count(Warning) == 0);
+
+  /// bad parameters group by tag, not by parameter
+  digest.clear();
+  parse("[size=x]a[/size][size=y]b[/size]", &digest);
+  assert(digest.messages().size() == 2);
+  assert(digest.messages()[0].first.name == "bad-parameter");
+  assert(digest.messages()[0].count == 2);
+  assert(digest.messages()[0].first.message.find("`x`") != std::string::npos);
+
+  /// past max groups new messages are only counted
+  MessageDigest small(2);
+  std::string spam;
+  for (usize i = 0; i < 1000; ++i) {
+    spam += "[t" + std::to_string(i) + "]";
+  }
+  parse(spam, &small);
+  assert(small.messages().size() == 2);
+  assert(small.omitted() == 998);
+  assert(small.count(Tidy) == 1000);
+
+  return 0;
+}
@@ -0,0 +1,47 @@
+#include "parallel.h"
+#include "fixtures.h"
+#include <cassert>
+
+using namespace bbcode::parser;
+using namespace bbcode::test;
+
+std::string sequential(const std::string &text, const ParseLimits &limits = {}) {
+  auto parsed = two_stage(text, limits);
+  return dump(parsed.nodes, parsed.messages);
+}
+
+int main() {
+  Random next(5);
+
+  /// same result as sequential for any split
+  for (usize round = 0; round < 500; ++round) {
+    auto text = soup(next, next(80));
+
+    auto expected = sequential(text);
+    for (usize threads : {1, 2, 3, 7}) {
+      auto result = bbcode::parallel::parse(text, threads, 1 + next(16));
+      assert(dump(result.nodes, result.messages) == expected);
+    }
+
+    /// depth and message limits hold as for the whole document
+    ParseLimits limits {.max_depth = 1 + next(3), .max_messages = 1 + next(4)};
+    auto result = bbcode::parallel::parse(text, 3, 1 + next(16), limits);
+    assert(dump(result.nodes, result.messages) == sequential(text, limits));
+  }
+
+  /// chunks of plain lines are not parsed again, an open tag across them is
+  std::string text;
+  for (usize i = 0; i < 1000; ++i) {
+    text += "line [b]bold[/b] :)\n";
+  }
+  auto result = bbcode::parallel::parse(text, 4, 1);
+  assert(result.serial_bytes < 100);
+  assert(dump(result.nodes, result.messages) == sequential(text));
+
+  text = "[i]" + text;
+  result = bbcode::parallel::parse(text, 4, 1);
+  assert(result.serial_bytes == text.size());
+  assert(dump(result.nodes, result.messages) == sequential(text));
+
+  return 0;
+}
@@ -0,0 +1,53 @@
+#include "pipeline.h"
+#include "fixtures.h"
+#include <thread>
+#include <cassert>
+
+using namespace bbcode::writer;
+using namespace bbcode::pipeline;
+using namespace bbcode::test;
+
+std::string sequential(const std::string &text) {
+  auto parsed = two_stage(text);
+  std::stringstream html;
+  for (const auto &node : parsed.nodes) {
+    write_html(node, &html);
+  }
+  return html.str() + describe(parsed.messages);
+}
+
+int main() {
+  Random next(7);
+
+  /// same output as sequential for any chunk, batch and ring size
+  for (usize round = 0; round < 200; ++round) {
+    auto text = soup(next, next(200));
+
+    std::istringstream input(text);
+    std::stringstream output;
+    auto result = render_html(&input, &output, Options {
+        .chunk_size = 1 + next(32),
+        .batch_size = 1 + next(8),
+        .ring_size = 1 + next(3),
+    });
+    assert(output.str() + describe(result.messages) == sequential(text));
+    assert(result.stages[ReadStage].batches >= text.size() / 32);
+  }
+
+  /// a full ring holds the producer back until the consumer pops
+  Ring<int> ring(2);
+  StageStats producer, consumer;
+  std::thread thread([&]() {
+    for (int i = 0; i < 1000; ++i) {
+      ring.back(&producer) = i;
+      ring.push();
+    }
+  });
+  for (int i = 0; i < 1000; ++i) {
+    assert(ring.front(&consumer) == i);
+    ring.pop();
+  }
+  thread.join();
+
+  return 0;
+}
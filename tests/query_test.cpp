@@ -0,0 +1,79 @@
+#include "fixtures.h"
+#include <cassert>
+
+using namespace bbcode::lexer;
+using namespace bbcode::parser;
+using namespace bbcode::test;
+using bbcode::query::Index;
+
+std::vector<Node> parse(const std::string &text, Index *index, bool lint = false) {
+  std::vector<Node> nodes;
+  Parser parser([&nodes](Node &&node) {
+    nodes.push_back(std::move(node));
+  }, [](Message &&) {});
+  parser.set_index(index);
+  parser.set_lint(lint);
+  Lexer lexer([&parser](LexItem &&item) {
+    parser.put(std::move(item));
+  });
+  lexer.put(text);
+  lexer.finish();
+  return nodes;
+}
+
+/// What the index replaces: parameters of `name` tags, in the same order.
+void walk(const Node &node, std::string_view name, std::vector<std::string_view> *out) {
+  for (const auto &child : node.children) {
+    walk(child, name, out);
+  }
+  if (node.type == bbcode::grammar::Parametric && node.name == name) {
+    out->push_back(node.data);
+  }
+}
+
+int main() {
+  /// tags and constants are listed with their positions
+  Index index;
+  parse("[b]x[/b] :)\n[url=http://a.b][b]y[/b][/url]", &index);
+  assert(index.tag("b").size() == 2);
+  assert(index.tag("b")[0].offset == 0 && index.tag("b")[0].span == 8);
+  assert(index.tag("b")[1].line == 1 && index.tag("b")[1].chr == 16);
+  assert(index.parameters("url") == std::vector<std::string_view> {"http://a.b"});
+  assert(index.constants().size() == 1);
+  assert(index.constants()[0].data == ":)" && index.constants()[0].offset == 9);
+  assert(index.tag("nope").empty() && index.tag("i").empty());
+
+  /// invalid nodes are not listed
+  index.clear();
+  parse("[list][b]x[/b][/list]", &index);
+  assert(index.tag("b").empty() && index.tag("list").size() == 1);
+
+  /// same as walking the tree, also without one
+  auto offsets = [&index]() {
+    std::vector<usize> result;
+    for (const auto &entry : index.constants()) {
+      result.push_back(entry.offset);
+    }
+    return result;
+  };
+  Random next(11);
+  for (usize round = 0; round < 300; ++round) {
+    auto text = soup(next, next(80));
+
+    index.clear();
+    std::vector<std::string_view> expected;
+    auto nodes = parse(text, &index);
+    for (const auto &node : nodes) {
+      walk(node, "url", &expected);
+    }
+    assert(index.parameters("url") == expected);
+    auto constants = offsets();
+
+    index.clear();
+    parse(text, &index, true);
+    assert(index.parameters("url") == expected);
+    assert(offsets() == constants);
+  }
+
+  return 0;
+}
@@ -0,0 +1,149 @@
+#include "writer.h"
+#include <sstream>
+#include <cassert>
+
+using namespace bbcode::lexer;
+using namespace bbcode::parser;
+using namespace bbcode::writer;
+
+std::string tidy(const std::string& input) {
+  std::stringstream ss;
+
+  Parser parser(Writer(&ss), [](Message&&) {});
+  Lexer lexer([&parser](LexItem&& item) {
+    parser.put(std::move(item));
+  });
+
+  for (const auto& c : input) {
+    lexer.put(c);
+  }
+
+  lexer.finish();
+  return ss.str();
+}
+
+std::string html(const std::string &input) {
+  std::stringstream ss;
+  Parser parser([&ss](Node &&node) {
+    if (node.type != bbcode::grammar::End) {
+      write_html(node, &ss);
+    }
+  }, [](Message&&) {});
+  Lexer lexer([&parser](LexItem&& item) {
+    parser.put(std::move(item));
+  });
+  lexer.put(input);
+  lexer.finish();
+  return ss.str();
+}
+
+/// Tree as tidy keeps it: text and tags, without positions. Invalid tags
+/// are reduced to their content, except verbatim ones, which tidy keeps.
+void shape(const Node &node, std::string *out) {
+  auto tag = [&](const std::string &open) {
+    *out += "\x01" + open + "\x02";
+    for (const auto &child : node.children) {
+      shape(child, out);
+    }
+    *out += "\x03";
+  };
+
+  switch (node.type) {
+    case bbcode::grammar::Literal:
+    case bbcode::grammar::Constant:
+      *out += node.data;
+      break;
+    case bbcode::grammar::Newline:
+      *out += '\n';
+      break;
+    case bbcode::grammar::Parametric:
+      tag(std::string(node.name) + "=" + std::string(node.data));
+      break;
+    case bbcode::grammar::Invalid:
+      if (!node.data.empty()) {
+        *out += node.data;
+      } else if (node.name == "code") {
+        tag(std::string(node.name));
+      } else {
+        for (const auto &child : node.children) {
+          shape(child, out);
+        }
+      }
+      break;
+    default:
+      tag(std::string(node.name));
+      break;
+  }
+}
+
+std::string parse(const std::string &input) {
+  std::string out;
+  Parser parser([&out](Node &&node) {
+    if (node.type != bbcode::grammar::End) {
+      shape(node, &out);
+    }
+  }, [](Message&&) {});
+  Lexer lexer([&parser](LexItem&& item) {
+    parser.put(std::move(item));
+  });
+  lexer.put(input);
+  lexer.finish();
+  return out;
+}
+
+int main() {
+  /// plain text and constants are kept
+  assert(tidy("hello :)\nworld") == "hello :)\nworld");
+
+  /// parameters are normalized
+  assert(tidy("[color=RED]x[/color]") == "[color=red]x[/color]");
+  assert(tidy("[font= serif, ,\"mono\"]x[/font]") == "[font=serif,mono]x[/font]");
+
+  /// missing close tags are added
+  assert(tidy("[b][i]x[/b]") == "[b][i]x[/i][/b]");
+  assert(tidy("[size=1]x") == "[size=1]x[/size]");
+
+  /// greedy and omission nodes have no close tag
+  assert(tidy("[list][*]a[*]b[/list][hr]") == "[list][*]a[*]b[/list][hr]");
+
+  /// greedy nodes at top level close each other
+  assert(tidy("[*]a[*]b") == "[*]a[*]b");
+
+  /// unpaired close tags are dropped, unknown tags stay as text
+  assert(tidy("a[/b]b[foo]") == "ab[foo]");
+
+  /// invalid nodes lose their tag
+  assert(tidy("[td]x[/td]") == "x");
+
+  /// incomplete tags are text and don't leak into the next tag
+  assert(tidy("[=b]x") == "[=b]x");
+  assert(tidy("[b=1\n[size=]x") == "[b=1\n[size=]x");
+
+  /// verbatim content is kept as is
+  assert(tidy("[code][b]:)[/code]") == "[code][b]:)[/code]");
+
+  /// misplaced verbatim tags keep their tag, so their text stays text
+  assert(tidy("[list][code][b]x[/b][/code][/list]") == "[list][code][b]x[/b][/code][/list]");
+  for (const char *x : {
+      "[tr][code][url=http://a]x[/url][/code][/tr]",
+      "[list][code][b]x[/b][/code][/list]",
+      "[table][code]:)\n[i]y[/code][/table]",
+      "[b][td]x[/td][/b] [list]a[*]b[code][hr][/list]",
+  }) {
+    auto expected = parse(x);
+    assert(parse(tidy(x)) == expected);
+  }
+
+  /// html keeps the text of invalid nodes as tidy does
+  assert(html("[list][b]x<[/b][/list]") == "<ul>x&lt;</ul>");
+  assert(html("[td]x[/td]") == "x");
+
+  /// schemes with non-ASCII bytes are not links
+  assert(html("[url=\xc3\x89:x]y[/url]") == "y");
+
+  /// output is stable
+  auto once = tidy("[b][color=Blue][font=\"a\"]x[*]y");
+  assert(tidy(once) == once);
+
+  return 0;
+}
@@ -0,0 +1,726 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <barrier>
+#include <mutex>
+#include <memory_resource>
+#include <chrono>
+#include <cstring>
+#include <cctype>
+
+#include "writer.h"
+#include "parallel.h"
+
+using namespace bbcode::lexer;
+using namespace bbcode::parser;
+using namespace bbcode::writer;
+
+static const usize BATCH_RECORDS = 4096;
+static const usize BATCH_BYTES = 16 << 20;
+/// posts this large are parsed on all threads if `splittable`, see
+/// `parallel::parse`
+static const usize LARGE_POST = 1 << 20;
+/// length prefixed records past this are skipped, see `read_record`
+static const u32 MAX_RECORD = 64 << 20;
+
+/// seconds one post may take, 0 for none, so output does not depend on load; set by `-t`
+static f64 post_seconds = 0;
+
+/// Limits for one post, so a hostile one can't stall a worker.
+static ParseLimits post_limits() {
+  auto limits = ParseLimits {
+      .max_depth = 256,
+      .max_nodes = 1 << 20,
+      .max_literal_bytes = 64 << 20,
+      .max_messages = 1000,
+  };
+  if (post_seconds > 0) {
+    auto seconds = std::chrono::duration<f64>(post_seconds);
+    limits.deadline = std::chrono::steady_clock::now() +
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(seconds);
+  }
+  return limits;
+}
+
+/// Whether `parallel::parse` would mostly run in parallel on `text`.
+///
+/// Chunks start after newlines, and their nodes only count from a line
+/// start with no tag open. Prose, chat and tables have many, while large
+/// [code] blocks, deep lists and unclosed garbage have almost none and are
+/// parsed again on one thread. Tags are counted by brackets alone, so
+/// `[x]` inside code or never closed reads as open.
+static bool splittable(std::string_view text) {
+  usize open = 0;
+  usize lines = 0;
+  usize clean = 0;
+  for (usize i = 0; i + 1 < text.size(); ++i) {
+    if (text[i] == '\n') {
+      ++lines;
+      clean += open == 0;
+    } else if (text[i] == '[') {
+      if (text[i + 1] == '/') {
+        open -= open != 0;
+      } else if (std::isalpha(u8(text[i + 1]))) {
+        ++open;
+      }
+    }
+  }
+  return clean >= lines / 16 && clean > 0;
+}
+
+enum Format {
+  /// one JSON object per line: `{"id": ..., "content": "..."}`
+  NDJson,
+
+  /// 32-bit little endian length followed by content
+  LengthPrefixed,
+};
+
+struct Record {
+  // id as JSON text, either given by input or record index
+  std::string id;
+  std::string content;
+  // non-empty if record is malformed
+  std::string error;
+};
+
+class JsonLine {
+ private:
+  std::string_view s;
+  usize pos = 0;
+
+  void skip_space() {
+    while (this->pos < this->s.size() &&
+        (this->s[this->pos] == ' ' || this->s[this->pos] == '\t' || this->s[this->pos] == '\r')) {
+      ++this->pos;
+    }
+  }
+
+  bool expect(char c) {
+    this->skip_space();
+    if (this->pos < this->s.size() && this->s[this->pos] == c) {
+      ++this->pos;
+      return true;
+    }
+    return false;
+  }
+
+  bool hex4(u32 &value) {
+    if (this->pos + 4 > this->s.size()) {
+      return false;
+    }
+
+    value = 0;
+    for (usize i = 0; i < 4; ++i) {
+      auto c = this->s[this->pos++];
+      value <<= 4;
+      if ('0' <= c && c <= '9') {
+        value |= u32(c - '0');
+      } else if ('a' <= c && c <= 'f') {
+        value |= u32(c - 'a' + 10);
+      } else if ('A' <= c && c <= 'F') {
+        value |= u32(c - 'A' + 10);
+      } else {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  static void put_utf8(u32 cp, std::string &out) {
+    if (cp < 0x80) {
+      out += char(cp);
+    } else if (cp < 0x800) {
+      out += char(0xc0 | (cp >> 6));
+      out += char(0x80 | (cp & 0x3f));
+    } else if (cp < 0x10000) {
+      out += char(0xe0 | (cp >> 12));
+      out += char(0x80 | ((cp >> 6) & 0x3f));
+      out += char(0x80 | (cp & 0x3f));
+    } else {
+      out += char(0xf0 | (cp >> 18));
+      out += char(0x80 | ((cp >> 12) & 0x3f));
+      out += char(0x80 | ((cp >> 6) & 0x3f));
+      out += char(0x80 | (cp & 0x3f));
+    }
+  }
+
+  bool string(std::string *out) {
+    if (!this->expect('"')) {
+      return false;
+    }
+
+    while (this->pos < this->s.size()) {
+      auto c = this->s[this->pos++];
+      if (c == '"') {
+        return true;
+      }
+
+      if (c != '\\') {
+        if (out) {
+          *out += c;
+        }
+        continue;
+      }
+
+      if (this->pos == this->s.size()) {
+        return false;
+      }
+
+      c = this->s[this->pos++];
+      char plain = 0;
+      switch (c) {
+        case '"': plain = '"'; break;
+        case '\\': plain = '\\'; break;
+        case '/': plain = '/'; break;
+        case 'b': plain = '\b'; break;
+        case 'f': plain = '\f'; break;
+        case 'n': plain = '\n'; break;
+        case 'r': plain = '\r'; break;
+        case 't': plain = '\t'; break;
+        case 'u': {
+          u32 cp;
+          if (!this->hex4(cp)) {
+            return false;
+          }
+
+          if (cp >= 0xd800 && cp < 0xdc00 &&
+              this->s.substr(this->pos, 2) == "\\u") {
+            this->pos += 2;
+            u32 low;
+            if (!this->hex4(low) || low < 0xdc00 || low >= 0xe000) {
+              return false;
+            }
+            cp = 0x10000 + ((cp - 0xd800) << 10) + (low - 0xdc00);
+          }
+
+          if (out) {
+            put_utf8(cp, *out);
+          }
+          continue;
+        }
+        default:
+          return false;
+      }
+
+      if (out) {
+        *out += plain;
+      }
+    }
+
+    return false;
+  }
+
+  bool value(std::string *raw) {
+    this->skip_space();
+    auto start = this->pos;
+    if (this->pos == this->s.size()) {
+      return false;
+    }
+
+    switch (this->s[this->pos]) {
+      case '"':
+        if (!this->string(nullptr)) {
+          return false;
+        }
+        break;
+      case '{':
+      case '[': {
+        // nested value, only need to skip it
+        usize depth = 0;
+        do {
+          if (this->pos == this->s.size()) {
+            return false;
+          }
+
+          auto c = this->s[this->pos];
+          if (c == '"') {
+            if (!this->string(nullptr)) {
+              return false;
+            }
+            continue;
+          }
+
+          if (c == '{' || c == '[') {
+            ++depth;
+          } else if (c == '}' || c == ']') {
+            --depth;
+          }
+          ++this->pos;
+        } while (depth != 0);
+        break;
+      }
+      default:
+        while (this->pos < this->s.size() &&
+            std::strchr(",} \t\r", this->s[this->pos]) == nullptr) {
+          ++this->pos;
+        }
+        if (this->pos == start) {
+          return false;
+        }
+    }
+
+    if (raw) {
+      *raw = this->s.substr(start, this->pos - start);
+    }
+    return true;
+  }
+
+ public:
+  explicit JsonLine(std::string_view s) : s(s) {}
+
+  bool parse(Record &record) {
+    if (!this->expect('{')) {
+      return false;
+    }
+
+    bool has_content = false;
+    if (this->expect('}')) {
+      return false;
+    }
+
+    do {
+      std::string key;
+      if (!this->string(&key) || !this->expect(':')) {
+        return false;
+      }
+
+      if (key == "id") {
+        if (!this->value(&record.id)) {
+          return false;
+        }
+      } else if (key == "content") {
+        record.content.clear();
+        if (!this->string(&record.content)) {
+          return false;
+        }
+        has_content = true;
+      } else if (!this->value(nullptr)) {
+        return false;
+      }
+    } while (this->expect(','));
+
+    return this->expect('}') && has_content;
+  }
+};
+
+/// Per-thread parsing state, reused across records.
+struct Worker {
+  std::stringstream ss;
+  std::stringstream nodes;
+  bool first = true;
+  usize error = 0;
+  usize warning = 0;
+  usize note = 0;
+
+  // nodes of one record are allocated here and dropped at once
+  std::vector<std::byte> arena = std::vector<std::byte>(64 * 1024);
+  std::pmr::monotonic_buffer_resource resource {arena.data(), arena.size()};
+
+  Parser parser;
+  Lexer lexer;
+  std::thread thread;
+
+  // posts left to this worker, taken from the front by it and from the
+  // back by others
+  std::mutex lock;
+  usize begin = 0;
+  usize end = 0;
+
+  usize posts = 0;
+  usize steals = 0;
+  f64 idle = 0;
+
+  Worker()
+      : parser([this](Node &&node) {
+        if (node.type == NodeType::End) {
+          this->nodes << "]";
+        } else {
+          this->add(node);
+        }
+      }, [](Message &&) {}, &this->resource),
+        lexer([this](LexItem &&item) {
+          this->parser.put(std::move(item));
+        }, &this->resource) {
+    // only counts are written, so messages are never formatted
+    this->parser.set_diagnostics([this](const Diagnostic &diagnostic) {
+      this->count(diagnostic.severity);
+    });
+  }
+
+  void add(const Node &node) {
+    if (!this->first) {
+      this->nodes << ",";
+    }
+    this->first = false;
+    write_json(node, &this->nodes);
+  }
+
+  void count(Severity severity) {
+    switch (severity) {
+      case Tidy: ++this->note; break;
+      case Warning: ++this->warning; break;
+      case Error: ++this->error; break;
+    }
+  }
+
+  /// Start the output of a record, false if it is malformed.
+  bool open(const Record &record) {
+    this->ss.str("");
+    this->ss << R"({"id":)" << record.id;
+    if (!record.error.empty()) {
+      this->ss << R"(,"error":")";
+      write_json_escape(record.error, &this->ss);
+      this->ss << "\"}";
+      return false;
+    }
+
+    this->nodes.str("");
+    this->nodes << "[";
+    this->first = true;
+    this->error = 0;
+    this->warning = 0;
+    this->note = 0;
+    return true;
+  }
+
+  void close() {
+    this->ss << R"(,"errors":)" << this->error << R"(,"warnings":)" << this->warning
+             << R"(,"notes":)" << this->note << R"(,"nodes":)" << this->nodes.rdbuf() << "}";
+  }
+
+  void parse(const Record &record) {
+    if (!this->open(record)) {
+      return;
+    }
+
+    this->resource.release();
+    this->parser.reset(&this->resource);
+    this->lexer.reset(&this->resource);
+    this->parser.set_limits(post_limits());
+
+    this->lexer.put(record.content);
+    this->lexer.finish();
+    this->close();
+  }
+
+  /// Parse one large record on `threads` threads.
+  void parse_large(const Record &record, usize threads) {
+    if (!this->open(record)) {
+      return;
+    }
+
+    auto result = bbcode::parallel::parse(record.content, threads, LARGE_POST / 4, post_limits());
+    for (const auto &node : result.nodes) {
+      this->add(node);
+    }
+    this->nodes << "]";
+    for (const auto &message : result.messages) {
+      this->count(message.severity);
+    }
+    this->close();
+  }
+};
+
+/// Posts of a batch are split among workers by size. A worker out of posts
+/// steals the back half of the fullest other worker's posts. Large posts
+/// that are `splittable` are parsed first, one at a time on all threads;
+/// other large posts are split among workers like the rest.
+class Pool {
+ private:
+  std::vector<Worker> workers;
+  std::barrier<> start;
+  std::barrier<> done;
+  const std::vector<Record> *batch = nullptr;
+  std::vector<std::string> *results = nullptr;
+  // records other than splittable large posts, split among workers
+  std::vector<usize> order;
+  bool stop = false;
+
+  bool take(Worker &worker, usize &record) {
+    {
+      std::lock_guard guard(worker.lock);
+      if (worker.begin < worker.end) {
+        record = this->order[worker.begin++];
+        return true;
+      }
+    }
+
+    while (true) {
+      Worker *victim = nullptr;
+      usize most = 0;
+      for (auto &other : this->workers) {
+        std::lock_guard guard(other.lock);
+        if (other.end - other.begin > most) {
+          most = other.end - other.begin;
+          victim = &other;
+        }
+      }
+
+      if (victim == nullptr) {
+        return false;
+      }
+
+      usize begin, end;
+      {
+        std::lock_guard guard(victim->lock);
+        if (victim->begin == victim->end) {
+          continue;
+        }
+        end = victim->end;
+        begin = end - (end - victim->begin + 1) / 2;
+        victim->end = begin;
+      }
+
+      ++worker.steals;
+      std::lock_guard guard(worker.lock);
+      worker.begin = begin + 1;
+      worker.end = end;
+      record = this->order[begin];
+      return true;
+    }
+  }
+
+  void run(Worker &worker) {
+    while (true) {
+      this->start.arrive_and_wait();
+      if (this->stop) {
+        return;
+      }
+
+      usize i;
+      while (this->take(worker, i)) {
+        worker.parse((*this->batch)[i]);
+        (*this->results)[i] = worker.ss.str();
+        ++worker.posts;
+      }
+
+      auto idle = std::chrono::steady_clock::now();
+      this->done.arrive_and_wait();
+      worker.idle += std::chrono::duration<f64>(std::chrono::steady_clock::now() - idle).count();
+    }
+  }
+
+ public:
+  explicit Pool(usize threads)
+      : workers(threads),
+        start(isize(threads + 1)),
+        done(isize(threads + 1)) {
+    for (auto &worker : this->workers) {
+      worker.thread = std::thread([this, &worker]() { this->run(worker); });
+    }
+  }
+
+  ~Pool() {
+    this->stop = true;
+    this->start.arrive_and_wait();
+    for (auto &worker : this->workers) {
+      worker.thread.join();
+    }
+  }
+
+  void process(const std::vector<Record> &records, std::vector<std::string> &outputs) {
+    outputs.resize(records.size());
+    this->batch = &records;
+    this->results = &outputs;
+
+    // workers wait at `start`, so the first one's state is free to use
+    this->order.clear();
+    usize bytes = 0;
+    for (usize i = 0; i < records.size(); ++i) {
+      if (records[i].error.empty() && records[i].content.size() >= LARGE_POST &&
+          splittable(records[i].content)) {
+        this->workers[0].parse_large(records[i], this->workers.size());
+        outputs[i] = this->workers[0].ss.str();
+      } else {
+        this->order.push_back(i);
+        bytes += records[i].content.size() + 1;
+      }
+    }
+
+    usize next = 0;
+    usize taken = 0;
+    for (usize w = 0; w < this->workers.size(); ++w) {
+      auto &worker = this->workers[w];
+      worker.begin = next;
+      auto share = bytes * (w + 1) / this->workers.size();
+      while (next < this->order.size() && (taken < share || w + 1 == this->workers.size())) {
+        taken += records[this->order[next++]].content.size() + 1;
+      }
+      worker.end = next;
+    }
+
+    this->start.arrive_and_wait();
+    this->done.arrive_and_wait();
+  }
+
+  /// Per worker posts, steals and idle time to `o`.
+  void write_stats(std::ostream *o) const {
+    for (usize i = 0; i < this->workers.size(); ++i) {
+      const auto &worker = this->workers[i];
+      *o << "worker " << i << ": " << worker.posts << " posts, " << worker.steals << " steals, "
+         << worker.idle << " s idle." << std::endl;
+    }
+  }
+};
+
+static bool read_record(std::istream *input, Format format, usize index, Record &record) {
+  record.id = std::to_string(index);
+  record.error.clear();
+
+  if (format == NDJson) {
+    std::string line;
+    do {
+      if (!std::getline(*input, line)) {
+        return false;
+      }
+    } while (line.find_first_not_of(" \t\r") == std::string::npos);
+
+    if (!JsonLine(line).parse(record)) {
+      record.id = std::to_string(index);
+      record.content.clear();
+      record.error = "Malformed record.";
+    }
+    return true;
+  }
+
+  u8 header[4];
+  if (!input->read(reinterpret_cast<char *>(header), 4)) {
+    return false;
+  }
+
+  auto length = u32(header[0]) | u32(header[1]) << 8 | u32(header[2]) << 16 | u32(header[3]) << 24;
+  if (length > MAX_RECORD) {
+    // skip it without allocating, the next record follows
+    input->ignore(std::streamsize(length));
+    record.content.clear();
+    record.error = "Record too large.";
+    return true;
+  }
+
+  record.content.resize(length);
+  if (!input->read(record.content.data(), length)) {
+    record.content.clear();
+    record.error = "Truncated record.";
+  }
+  return true;
+}
+
+int main(int argc, char ** argv) {
+  std::istream* input = &std::cin;
+  std::ostream* output = &std::cout;
+
+  std::ifstream file_in;
+  std::ofstream file_out;
+
+  Format format = NDJson;
+  usize threads = std::max(1u, std::thread::hardware_concurrency());
+  std::vector<std::string_view> files;
+  bool print_stats = false;
+
+  for (int i = 1; i < argc; ++i) {
+    auto arg = std::string_view(argv[i]);
+    if (arg == "-l") {
+      format = LengthPrefixed;
+    } else if (arg == "-v") {
+      print_stats = true;
+    } else if (arg == "-j" && i + 1 < argc) {
+      threads = std::max(1ul, std::strtoul(argv[++i], nullptr, 10));
+    } else if (arg == "-t" && i + 1 < argc) {
+      post_seconds = std::max(0.0, std::strtod(argv[++i], nullptr));
+    } else if (arg.size() > 1 && arg[0] == '-') {
+      std::cerr << "Usage: batch_tool [-j threads] [-t seconds] [-l] [-v] [input_file] [output_file]"
+                << std::endl;
+      exit(1);
+    } else {
+      files.push_back(arg);
+    }
+  }
+
+  if (files.size() >= 1 && files[0] != "-") {
+    file_in = std::ifstream(files[0].data(), std::ios::binary);
+    if (file_in.is_open()) {
+      input = &file_in;
+    } else {
+      std::cerr << "Failed opening file: " << files[0] << " for read." << std::endl;
+      exit(1);
+    }
+  }
+
+  if (files.size() >= 2 && files[1] != "-") {
+    file_out = std::ofstream(files[1].data(), std::ios::binary | std::ios::trunc);
+    if (file_out.is_open()) {
+      output = &file_out;
+    } else {
+      std::cerr << "Failed opening file: " << files[1] << " for write." << std::endl;
+      exit(1);
+    }
+  }
+
+  auto begin = std::chrono::steady_clock::now();
+  usize count = 0;
+  usize bytes = 0;
+
+  {
+    Pool pool(threads);
+    std::vector<Record> records;
+    std::vector<std::string> outputs;
+
+    bool more = true;
+    while (more) {
+      records.resize(BATCH_RECORDS);
+      usize size = 0;
+      usize batch_bytes = 0;
+      while (size < BATCH_RECORDS && batch_bytes < BATCH_BYTES) {
+        if (!read_record(input, format, count + size, records[size])) {
+          more = false;
+          break;
+        }
+        batch_bytes += records[size].content.size();
+        ++size;
+      }
+
+      records.resize(size);
+      if (records.empty()) {
+        break;
+      }
+
+      pool.process(records, outputs);
+      for (const auto &line : outputs) {
+        *output << line << '\n';
+      }
+
+      if (!output->good()) {
+        std::cerr << "Failed writing output." << std::endl;
+        exit(1);
+      }
+
+      count += size;
+      bytes += batch_bytes;
+    }
+
+    if (print_stats) {
+      pool.write_stats(&std::cerr);
+    }
+  }
+
+  output->flush();
+
+  auto seconds = std::chrono::duration<f64>(std::chrono::steady_clock::now() - begin).count();
+  std::cerr << count << " posts, " << bytes << " bytes in " << seconds << " s: "
+            << f64(count) / seconds << " posts/s, "
+            << f64(bytes) / seconds / 1e6 << " MB/s." << std::endl;
+
+  if (file_in.is_open()) {
+    file_in.close();
+  }
+
+  if (file_out.is_open()) {
+    file_out.close();
+  }
+
+  return 0;
+}
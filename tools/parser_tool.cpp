@@ -4,29 +4,14 @@
 
 #include <iostream>
 #include <iomanip>
-#include <array>
 #include <fstream>
 
-#include "parser.h"
-#include "cassert"
+#include "writer.h"
+#include "source.h"
 
 using namespace bbcode::lexer;
 using namespace bbcode::parser;
-
-static auto NodeTypeNames = std::array {
-    "Invalid",
-    "Omission",
-    "Simple",
-    "Parametric",
-    "Greedy",
-    "Verbatim",
-    "Literal",
-    "Constant",
-    "Newline",
-    "End"
-};
-
-static auto NodeTypeNamesBase = &NodeTypeNames[1];
+using namespace bbcode::writer;
 
 namespace Color {
 enum Code {
@@ -54,120 +39,65 @@ static Color::Modifier def(Color::FG_DEFAULT);
 
 }
 
-static void write_escape(std::string_view s, std::ostream* o) {
-  for (const auto& c : s) {
-    switch (c) {
-      case '"':
-        *o << "\\\"";
-        break;
-      case '\\':
-        *o << "\\\\";
-        break;
-      case '\r':
-        *o << "\\r";
-        break;
-      case '\n':
-        *o << "\\n";
-        break;
-      default:
-        *o << c;
-        break;
-    }
-  }
-}
-
-void write_node_as_json(const Node& node, std::ostream* o) {
-  *o << R"({"type":")" << *(NodeTypeNamesBase + node.type)
-     << R"(","line":)" << node.line << R"(,"chr":)" << node.chr
-     << R"(,"offset":)" << node.offset << R"(,"span":)" << node.span;
-  switch (node.type) {
-    case bbcode::grammar::Literal:
-    case bbcode::grammar::Constant: {
-      *o << R"(,"content":")";
-      write_escape(node.data, o);
-      *o << "\"}";
-      break;
-    }
-    case bbcode::grammar::Omission:
-      *o << R"(,"name":")" << node.name << "\"}";
+static void print_message(const Message &message, Source &source) {
+  std::cerr << "L" << message.line + 1 << ":" << message.chr + 1 << ":\t";
+  Color::Modifier cur;
+  switch (message.severity) {
+    case Tidy:
+      cur = Color::cyan;
+      std::cerr << cur << "Note: " << Color::def;
       break;
-    case bbcode::grammar::Simple:
-    case bbcode::grammar::Greedy:
-    case bbcode::grammar::Verbatim: {
-      *o << R"(,"name":")" << node.name << "\"";
-      *o << R"(,"content":[)";
-      for (auto it = node.children.begin(); it != node.children.end(); ++it) {
-        write_node_as_json(*it, o);
-        if (it + 1 != node.children.end()) {
-          *o << ",";
-        }
-      }
-      *o << "]}";
+    case Warning:
+      cur = Color::magenta;
+      std::cerr << cur << "Warning: " << Color::def;
       break;
-    }
-    case bbcode::grammar::Parametric: {
-      *o << R"(,"name":")" << node.name << "\"";
-      *o << R"(,"parameter":")" << node.data << "\"";
-      *o << R"(,"content":[)";
-      for (auto it = node.children.begin(); it != node.children.end(); ++it) {
-        write_node_as_json(*it, o);
-        if (it + 1 != node.children.end()) {
-          *o << ",";
-        }
-      }
-      *o << "]}";
+    case Error:
+      cur = Color::red;
+      std::cerr << cur << "Error: " << Color::def;
       break;
-    }
-    case bbcode::grammar::Newline:
-      *o << "}";
-      break;
-    case bbcode::grammar::Invalid: {
-      *o << R"(,"name":")" << node.name << "\"";
-      if (!node.data.empty()) {
-        *o << R"(,"content":")";
-        write_escape(node.data, o);
-        *o << "\"";
-      } else if (!node.children.empty()) {
-        *o << R"(,"content":[)";
-        for (auto it = node.children.begin(); it != node.children.end(); ++it) {
-          write_node_as_json(*it, o);
-          if (it + 1 != node.children.end()) {
-            *o << ",";
-          }
-        }
-        *o << "]";
-      }
-      *o << "}";
-      break;
-    }
-    case bbcode::grammar::End:
-      assert(false);
   }
+
+  std::cerr << message.message << " [" << cur << "-W" << message.name << Color::def << "]" << std::endl;
+  std::cerr << std::setw(5) << std::setfill(' ') << message.line + 1 << std::setw(0);
+  std::cerr << " | " << source.line(message.line) << std::endl;
+  std::cerr << "      | " << std::string(message.chr, ' ') << cur << '^';
+  if (message.span > 1) {
+    std::cerr << std::string(message.span - 1, '~');
+  }
+  std::cerr << Color::def << std::endl;
 }
 
 int main(int argc, char ** argv) {
-  std::istream* input = &std::cin;
   std::ostream* output = &std::cout;
 
-  std::ifstream file_in;
   std::ofstream file_out;
 
-  std::vector<std::string> source {{}};
-  usize error = 0;
-  usize warning = 0;
-  usize note = 0;
-
-  if (argc >= 2) {
-    auto i = std::string_view(argv[1]);
-    if (i != "-") {
-      file_in = std::ifstream(i.data(), std::ios::binary);
-      if (file_in.is_open()) {
-        input = &file_in;
-      } else {
-        std::cerr << "Failed opening file: " << i << " for read." << std::endl;
-        exit(1);
-      }
+  Source source;
+  MessageDigest digest;
+
+  bool print_stats = false;
+  usize preview = 0;
+  bool lint = false;
+  while (argc >= 2) {
+    if (std::string_view(argv[1]) == "--stats") {
+      print_stats = true;
+    } else if (std::string_view(argv[1]) == "--lint") {
+      lint = true;
+    } else if (std::string_view(argv[1]) == "--preview" && argc >= 3) {
+      preview = std::strtoul(argv[2], nullptr, 10);
+      --argc;
+      ++argv;
+    } else {
+      break;
     }
+    --argc;
+    ++argv;
+  }
+
+  auto i = std::string_view(argc >= 2 ? argv[1] : "-");
+  if (!source.open(i)) {
+    std::cerr << "Failed opening file: " << i << " for read." << std::endl;
+    exit(1);
   }
 
   if (argc >= 3) {
@@ -183,7 +113,9 @@ int main(int argc, char ** argv) {
     }
   }
 
-  *output << "[";
+  if (!lint) {
+    *output << "[";
+  }
 
   Parser parser([output, first = true](Node&& node) mutable {
     if (node.type == NodeType::End) {
@@ -192,62 +124,61 @@ int main(int argc, char ** argv) {
       if (!first) {
         *output << ",";
       }
-      write_node_as_json(node, output);
+      write_json(node, output);
     }
 
     if (first) {
       first = false;
     }
-  }, [&](Message&& message) {
-    std::cerr << "L" << message.line + 1 << ":" << message.chr + 1 << ":\t";
-    Color::Modifier cur;
-    switch (message.severity) {
-      case Tidy:
-        ++note;
-        cur = Color::cyan;
-        std::cerr << cur << "Note: " << Color::def;
-        break;
-      case Warning:
-        ++warning;
-        cur = Color::magenta;
-        std::cerr << cur << "Warning: " << Color::def;
-        break;
-      case Error:
-        ++error;
-        cur = Color::red;
-        std::cerr << cur << "Error: " << Color::def;
-        break;
-    }
-
-    std::cerr << message.message << " [" << cur << "-W" << message.name << Color::def << "]" << std::endl;
-    std::cerr << std::setw(5) << std::setfill(' ') << message.line + 1 << std::setw(0);
-    std::cerr << " | " << source[message.line] << std::endl;
-    std::cerr << "      | " << std::string(message.chr, ' ') << cur << '^';
-    if (message.span > 1) {
-      std::cerr << std::string(message.span - 1, '~');
-    }
-    std::cerr << Color::def << std::endl;
-  });
+  }, [](Message&&) {});
+  // repeated messages are printed once, so spammy input stays readable
+  parser.set_diagnostics(digest.handler());
   Lexer lexer([&parser](LexItem&& item) {
     parser.put(std::move(item));
   });
 
-  while (input->good()) {
-    auto next = input->get();
-    if (!input->eof()) {
-      if (next == '\n') {
-        source.emplace_back();
-      } else {
-        source.back() += char(next);
-      }
-      lexer.put(static_cast<i8>(next));
-    } else {
-      break;
-    }
+  bbcode::ParseStats stats;
+  if (print_stats) {
+#ifdef BBCODE_STATS
+    lexer.set_stats(&stats);
+    parser.set_stats(&stats);
+#else
+    std::cerr << "Stats not collected: built without BBCODE_STATS." << std::endl;
+    print_stats = false;
+#endif
+  }
+
+  parser.set_lint(lint);
+  if (preview) {
+    parser.set_limits(ParseLimits {.max_visible = preview});
   }
 
+  // in blocks, so a preview stops reading soon after its last character
+  static const usize BLOCK = 4096;
+  auto view = source.view();
+  for (usize i = 0; i < view.size() && parser.current_state() != Done; i += BLOCK) {
+    lexer.put(view.substr(i, BLOCK));
+  }
   lexer.finish();
 
+  if (auto cut = parser.preview_end()) {
+    std::cerr << "Preview ends at offset " << *cut << " of " << view.size() << "." << std::endl;
+  }
+
+  for (const auto &group : digest.messages()) {
+    print_message(group.first, source);
+    if (group.count > 1) {
+      std::cerr << "      | " << group.count - 1 << " more, last at L" << group.last_line + 1
+                << ":" << group.last_chr + 1 << "." << std::endl;
+    }
+  }
+  if (digest.omitted()) {
+    std::cerr << digest.omitted() << " more messages not shown." << std::endl;
+  }
+
+  auto error = digest.count(Error);
+  auto warning = digest.count(Warning);
+  auto note = digest.count(Tidy);
   if (error || warning || note) {
     std::cerr << error << " error";
     if (error > 1) {
@@ -266,8 +197,9 @@ int main(int argc, char ** argv) {
     std::cerr << " generated." << std::endl;
   }
 
-  if (file_in.is_open()) {
-    file_in.close();
+  if (print_stats) {
+    bbcode::write_stats(stats, &std::cerr);
+    std::cerr << std::endl;
   }
 
   if (file_out.is_open()) {
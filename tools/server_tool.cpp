@@ -0,0 +1,603 @@
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <optional>
+#include <utility>
+#include <array>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory_resource>
+#include <csignal>
+#include <cstring>
+#include <cassert>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "writer.h"
+
+using namespace bbcode::lexer;
+using namespace bbcode::parser;
+using namespace bbcode::writer;
+
+/// Request frame: u32 little endian length of the rest, u8 op, payload.
+/// Response frame: u32 little endian length of the rest, u8 status, payload.
+/// Frames can be pipelined, responses are sent in request order.
+enum Op {
+  /// payload: BBCode; reply: `{"nodes":[...],"errors":..,"warnings":..,"notes":..}`
+  ParseJson = 0,
+
+  /// payload: BBCode; reply: HTML
+  RenderHtml,
+
+  /// payload: BBCode; reply: top level nodes in `write_binary` form
+  ParseBinary,
+
+  /// payload: BBCode; reply: canonical BBCode
+  TidyBBCode,
+
+  /// payload: empty; reply: counters as JSON
+  GetStats,
+};
+
+enum Status {
+  Ok = 0,
+  BadRequest,
+};
+
+static const usize MAX_FRAME = 64 << 20;
+static const usize LATENCY_BUCKETS = 32;
+static const auto IDLE_TIMEOUT = std::chrono::seconds(60);
+
+/// seconds one post may take, 0 for none; set by `-t`
+static f64 post_seconds = 1;
+
+/// Limits for one post, so a hostile one can't stall a worker.
+static ParseLimits post_limits() {
+  auto limits = ParseLimits {
+      .max_depth = 256,
+      .max_nodes = 1 << 20,
+      .max_literal_bytes = 64 << 20,
+      .max_messages = 1000,
+  };
+  if (post_seconds > 0) {
+    auto seconds = std::chrono::duration<f64>(post_seconds);
+    limits.deadline = std::chrono::steady_clock::now() +
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(seconds);
+  }
+  return limits;
+}
+
+struct Counters {
+  std::atomic<u64> connections{0};
+  std::atomic<u64> requests{0};
+  std::atomic<u64> bad_requests{0};
+  std::atomic<u64> bytes_in{0};
+  std::atomic<u64> bytes_out{0};
+
+  // bucket i counts requests that took less than 2^i microseconds
+  std::array<std::atomic<u64>, LATENCY_BUCKETS> latency{};
+
+  void record(std::chrono::steady_clock::duration elapsed) {
+    auto us = u64(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+    usize bucket = 0;
+    while (bucket + 1 < LATENCY_BUCKETS && (u64(1) << bucket) <= us) {
+      ++bucket;
+    }
+    ++this->latency[bucket];
+  }
+
+  void write(std::ostream *o) {
+    *o << R"({"connections":)" << this->connections
+       << R"(,"requests":)" << this->requests
+       << R"(,"bad_requests":)" << this->bad_requests
+       << R"(,"bytes_in":)" << this->bytes_in
+       << R"(,"bytes_out":)" << this->bytes_out
+       << R"(,"latency_us":{)";
+    for (usize i = 0; i < LATENCY_BUCKETS; ++i) {
+      *o << "\"<" << (u64(1) << i) << "\":" << this->latency[i];
+      if (i + 1 != LATENCY_BUCKETS) {
+        *o << ",";
+      }
+    }
+    *o << "}}";
+  }
+};
+
+static Counters counters;
+static std::string socket_path;
+
+/// Per-thread parsing state, reused across requests.
+class Renderer {
+ private:
+  Op op = ParseJson;
+  std::ostream *o = nullptr;
+  bool first = true;
+  usize error = 0;
+  usize warning = 0;
+  usize note = 0;
+
+  // nodes of one request are allocated here and dropped at once
+  std::vector<std::byte> arena = std::vector<std::byte>(64 * 1024);
+  std::pmr::monotonic_buffer_resource resource {arena.data(), arena.size()};
+
+  Parser parser;
+  Lexer lexer;
+
+  void write(Node &&node) {
+    if (node.type == NodeType::End) {
+      return;
+    }
+
+    switch (this->op) {
+      case ParseJson:
+        if (!this->first) {
+          *this->o << ",";
+        }
+        write_json(node, this->o);
+        break;
+      case RenderHtml:
+        write_html(node, this->o);
+        break;
+      case ParseBinary:
+        write_binary(node, this->o);
+        break;
+      case TidyBBCode:
+        write_bbcode(node, this->o);
+        break;
+      case GetStats:
+        assert(false);
+    }
+    this->first = false;
+  }
+
+ public:
+  Renderer()
+      : parser([this](Node &&node) {
+        this->write(std::move(node));
+      }, [](Message &&) {}, &this->resource),
+        lexer([this](LexItem &&item) {
+          this->parser.put(std::move(item));
+        }, &this->resource) {
+    // only counts are written, so messages are never formatted
+    this->parser.set_diagnostics([this](const Diagnostic &diagnostic) {
+      switch (diagnostic.severity) {
+        case Tidy: ++this->note; break;
+        case Warning: ++this->warning; break;
+        case Error: ++this->error; break;
+      }
+    });
+  }
+
+  Renderer(const Renderer &) = delete;
+  Renderer &operator=(const Renderer &) = delete;
+
+  void parse(std::string_view input, Op request, std::ostream *output) {
+    this->op = request;
+    this->o = output;
+    this->first = true;
+    this->error = 0;
+    this->warning = 0;
+    this->note = 0;
+    this->resource.release();
+    this->parser.reset(&this->resource);
+    this->lexer.reset(&this->resource);
+    this->parser.set_limits(post_limits());
+
+    if (this->op == ParseJson) {
+      *this->o << R"({"nodes":[)";
+    }
+
+    this->lexer.put(input);
+    this->lexer.finish();
+
+    if (this->op == ParseJson) {
+      *this->o << R"(],"errors":)" << this->error << R"(,"warnings":)" << this->warning
+               << R"(,"notes":)" << this->note << "}";
+    }
+  }
+};
+
+static void put_u32(u32 value, std::string &out) {
+  for (usize i = 0; i < 4; ++i) {
+    out += char(u8(value >> (i * 8)));
+  }
+}
+
+static u32 get_u32(const char *p) {
+  auto b = reinterpret_cast<const u8 *>(p);
+  return u32(b[0]) | u32(b[1]) << 8 | u32(b[2]) << 16 | u32(b[3]) << 24;
+}
+
+/// Length of the complete frames at the front of `in`, or `std::nullopt`
+/// if it starts with a malformed frame.
+static std::optional<usize> complete_frames(std::string_view in) {
+  usize end = 0;
+  while (in.size() - end >= 4) {
+    auto length = get_u32(in.data() + end);
+    if (length == 0 || length > MAX_FRAME) {
+      // answer the frames before it first
+      if (end == 0) {
+        return std::nullopt;
+      }
+      break;
+    }
+    if (in.size() - end - 4 < length) {
+      break;
+    }
+    end += 4 + length;
+  }
+  return end;
+}
+
+/// Reply frames to complete request `frames`, in order.
+static std::string answer(std::string_view frames, Renderer &renderer, std::stringstream &ss) {
+  std::string out;
+  while (!frames.empty()) {
+    auto begin = std::chrono::steady_clock::now();
+    auto length = get_u32(frames.data());
+    auto op = u8(frames[4]);
+    auto payload = frames.substr(5, length - 1);
+    frames.remove_prefix(4 + length);
+
+    ss.str("");
+    auto status = Ok;
+    switch (op) {
+      case ParseJson:
+      case RenderHtml:
+      case ParseBinary:
+      case TidyBBCode:
+        renderer.parse(payload, Op(op), &ss);
+        break;
+      case GetStats:
+        counters.write(&ss);
+        break;
+      default:
+        ++counters.bad_requests;
+        status = BadRequest;
+        ss << "Unknown op.";
+    }
+
+    auto reply = ss.str();
+    put_u32(u32(reply.size() + 1), out);
+    out += char(status);
+    out += reply;
+
+    ++counters.requests;
+    counters.record(std::chrono::steady_clock::now() - begin);
+  }
+  return out;
+}
+
+/// Complete frames of one connection, answered by a worker.
+struct Job {
+  int fd;
+  std::string frames;
+  std::string reply;
+};
+
+/// Workers only see complete frames, so idle or slow connections never hold
+/// one. Finished jobs are collected by the socket loop, which is woken by a
+/// byte on `wake`.
+class Pool {
+ private:
+  std::vector<std::thread> threads;
+  std::deque<Job> pending;
+  std::deque<Job> done;
+  std::mutex mutex;
+  std::condition_variable ready;
+  int wake;
+
+  void run() {
+    Renderer renderer;
+    std::stringstream ss;
+    while (true) {
+      Job job;
+      {
+        std::unique_lock lock(this->mutex);
+        this->ready.wait(lock, [this]() { return !this->pending.empty(); });
+        job = std::move(this->pending.front());
+        this->pending.pop_front();
+      }
+
+      job.reply = answer(job.frames, renderer, ss);
+      job.frames = std::string();
+      {
+        std::lock_guard lock(this->mutex);
+        this->done.push_back(std::move(job));
+      }
+      // a full pipe already wakes the loop
+      char c = 0;
+      [[maybe_unused]] auto ignored = ::write(this->wake, &c, 1);
+    }
+  }
+
+ public:
+  Pool(usize size, int wake) : wake(wake) {
+    for (usize i = 0; i < size; ++i) {
+      this->threads.emplace_back([this]() { this->run(); });
+    }
+  }
+
+  void submit(Job &&job) {
+    {
+      std::lock_guard lock(this->mutex);
+      this->pending.push_back(std::move(job));
+    }
+    this->ready.notify_one();
+  }
+
+  std::deque<Job> collect() {
+    std::lock_guard lock(this->mutex);
+    return std::exchange(this->done, {});
+  }
+};
+
+/// Socket state kept by the loop between reads.
+struct Connection {
+  std::string in;
+  std::string out;
+  usize written = 0;
+  /// frames of it are in the pool, at most one job at a time so replies
+  /// stay in order
+  bool busy = false;
+  /// peer closed or sent a bad frame, close once replies are written
+  bool closing = false;
+  std::chrono::steady_clock::time_point active;
+};
+
+static void set_nonblocking(int fd) {
+  ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+}
+
+/// Read what is available. False if the connection should stop reading.
+static bool read_some(int fd, Connection &connection) {
+  char block[1 << 16];
+  while (true) {
+    auto got = ::read(fd, block, sizeof(block));
+    if (got < 0 && errno == EINTR) {
+      continue;
+    }
+    if (got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      return true;
+    }
+    if (got <= 0) {
+      return false;
+    }
+    counters.bytes_in += u64(got);
+    connection.in.append(block, usize(got));
+    connection.active = std::chrono::steady_clock::now();
+    if (usize(got) < sizeof(block)) {
+      return true;
+    }
+  }
+}
+
+/// Write what the socket takes. False on error.
+static bool write_some(int fd, Connection &connection) {
+  while (connection.written < connection.out.size()) {
+    auto data = std::string_view(connection.out).substr(connection.written);
+    auto written = ::write(fd, data.data(), data.size());
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return errno == EAGAIN || errno == EWOULDBLOCK;
+    }
+    connection.written += usize(written);
+    counters.bytes_out += u64(written);
+    if (written > 0) {
+      // a slow reader still making progress is not idle
+      connection.active = std::chrono::steady_clock::now();
+    }
+  }
+  connection.out.clear();
+  connection.written = 0;
+  return true;
+}
+
+/// Accept, read and write on one thread with `poll`, and hand complete
+/// frames to `pool`. Connections idle for `IDLE_TIMEOUT`, including ones
+/// stuck in the middle of a frame, are closed.
+static void serve(int listener, int wake, Pool &pool) {
+  std::unordered_map<int, Connection> connections;
+  std::vector<pollfd> fds;
+
+  auto close = [&connections](int fd) {
+    ::close(fd);
+    connections.erase(fd);
+  };
+
+  // hand over complete frames, or close once nothing is left to do
+  auto dispatch = [&](int fd, Connection &connection) {
+    if (connection.busy) {
+      return;
+    }
+    auto end = complete_frames(connection.in);
+    if (!end) {
+      ++counters.bad_requests;
+      connection.in.clear();
+      connection.closing = true;
+    } else if (*end) {
+      connection.busy = true;
+      pool.submit(Job {.fd = fd, .frames = connection.in.substr(0, *end)});
+      connection.in.erase(0, *end);
+      return;
+    }
+    if (connection.closing && connection.out.empty()) {
+      close(fd);
+    }
+  };
+
+  while (true) {
+    fds.clear();
+    fds.push_back(pollfd {.fd = listener, .events = POLLIN});
+    fds.push_back(pollfd {.fd = wake, .events = POLLIN});
+    for (const auto &[fd, connection] : connections) {
+      short events = 0;
+      // read only between jobs, so a client can't queue unbounded input
+      if (!connection.busy && !connection.closing && connection.out.empty()) {
+        events |= POLLIN;
+      }
+      if (!connection.out.empty()) {
+        events |= POLLOUT;
+      }
+      if (events) {
+        fds.push_back(pollfd {.fd = fd, .events = events});
+      }
+    }
+
+    if (::poll(fds.data(), fds.size(), 1000) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      std::cerr << "Failed polling sockets: " << std::strerror(errno) << std::endl;
+      exit(1);
+    }
+
+    for (usize i = 2; i < fds.size(); ++i) {
+      auto fd = fds[i].fd;
+      auto it = connections.find(fd);
+      if (it == connections.end() || !fds[i].revents) {
+        continue;
+      }
+      auto &connection = it->second;
+
+      if ((fds[i].revents & POLLOUT) && !write_some(fd, connection)) {
+        close(fd);
+        continue;
+      }
+      if (fds[i].revents & (POLLIN | POLLHUP | POLLERR)) {
+        if (!read_some(fd, connection)) {
+          connection.closing = true;
+        }
+      }
+      if (connection.out.empty()) {
+        dispatch(fd, connection);
+      }
+    }
+
+    if (fds[1].revents & POLLIN) {
+      char drain[256];
+      while (::read(wake, drain, sizeof(drain)) > 0) {}
+      for (auto &job : pool.collect()) {
+        auto &connection = connections.at(job.fd);
+        connection.busy = false;
+        connection.out = std::move(job.reply);
+        connection.active = std::chrono::steady_clock::now();
+        if (!write_some(job.fd, connection)) {
+          close(job.fd);
+        } else if (connection.out.empty()) {
+          dispatch(job.fd, connection);
+        }
+      }
+    }
+
+    if (fds[0].revents & POLLIN) {
+      while (true) {
+        int fd = ::accept(listener, nullptr, nullptr);
+        if (fd < 0) {
+          if (errno == EINTR || errno == ECONNABORTED) {
+            continue;
+          }
+          if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            std::cerr << "Failed accepting connection: " << std::strerror(errno) << std::endl;
+          }
+          break;
+        }
+        ++counters.connections;
+        set_nonblocking(fd);
+        connections[fd].active = std::chrono::steady_clock::now();
+      }
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    for (auto it = connections.begin(); it != connections.end();) {
+      const auto &connection = it->second;
+      if (!connection.busy && now - connection.active > IDLE_TIMEOUT) {
+        ::close(it->first);
+        it = connections.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+}
+
+static void warm_up() {
+  // build constant trie and touch grammar tables before the first request
+  Renderer renderer;
+  std::stringstream ss;
+  renderer.parse("[b][size=1][color=red]:)[/color][/size][/b]", ParseJson, &ss);
+}
+
+extern "C" void on_exit_signal(int) {
+  ::unlink(socket_path.c_str());
+  _exit(0);
+}
+
+int main(int argc, char ** argv) {
+  usize threads = std::max(1u, std::thread::hardware_concurrency());
+
+  for (int i = 1; i < argc; ++i) {
+    auto arg = std::string_view(argv[i]);
+    if (arg == "-j" && i + 1 < argc) {
+      threads = std::max(1ul, std::strtoul(argv[++i], nullptr, 10));
+    } else if (arg == "-t" && i + 1 < argc) {
+      post_seconds = std::max(0.0, std::strtod(argv[++i], nullptr));
+    } else if (arg.size() > 1 && arg[0] == '-') {
+      socket_path.clear();
+      break;
+    } else {
+      socket_path = arg;
+    }
+  }
+
+  if (socket_path.empty()) {
+    std::cerr << "Usage: server_tool [-j threads] [-t seconds] socket_path" << std::endl;
+    exit(1);
+  }
+
+  sockaddr_un address {};
+  address.sun_family = AF_UNIX;
+  if (socket_path.size() >= sizeof(address.sun_path)) {
+    std::cerr << "Socket path too long: " << socket_path << std::endl;
+    exit(1);
+  }
+  std::memcpy(address.sun_path, socket_path.c_str(), socket_path.size() + 1);
+
+  int listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  ::unlink(socket_path.c_str());
+  if (listener < 0 ||
+      ::bind(listener, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 ||
+      ::listen(listener, 128) != 0) {
+    std::cerr << "Failed listening on socket: " << socket_path << ": "
+              << std::strerror(errno) << std::endl;
+    exit(1);
+  }
+
+  std::signal(SIGPIPE, SIG_IGN);
+  std::signal(SIGINT, on_exit_signal);
+  std::signal(SIGTERM, on_exit_signal);
+
+  int wake[2];
+  if (::pipe(wake) != 0) {
+    std::cerr << "Failed creating pipe: " << std::strerror(errno) << std::endl;
+    exit(1);
+  }
+  set_nonblocking(listener);
+  set_nonblocking(wake[0]);
+  set_nonblocking(wake[1]);
+
+  warm_up();
+  Pool pool(threads, wake[1]);
+  serve(listener, wake[0], pool);
+}
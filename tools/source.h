@@ -0,0 +1,140 @@
+#ifndef BBCODE_TOOLS_SOURCE_H_
+#define BBCODE_TOOLS_SOURCE_H_
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+#include "defs.h"
+
+#if __has_include(<sys/mman.h>)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#define BBCODE_HAS_MMAP 1
+#endif
+
+/// Whole input document, memory mapped when it is a regular file and read
+/// in large blocks otherwise (pipes, terminals).
+class Source {
+ private:
+  static constexpr usize BLOCK_SIZE = 1 << 16;
+
+  const char *data = nullptr;
+  usize length = 0;
+  bool mapped = false;
+  std::string owned;
+  std::vector<usize> line_starts{0};
+  usize scanned = 0;
+
+  bool read_stream(std::FILE *file) {
+    usize got;
+    do {
+      auto size = this->owned.size();
+      this->owned.resize(size + BLOCK_SIZE);
+      got = std::fread(this->owned.data() + size, 1, BLOCK_SIZE, file);
+      this->owned.resize(size + got);
+    } while (got == BLOCK_SIZE);
+
+    this->data = this->owned.data();
+    this->length = this->owned.size();
+    return !std::ferror(file);
+  }
+
+#ifdef BBCODE_HAS_MMAP
+  bool map(int fd) {
+    struct stat st {};
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+      return false;
+    }
+
+    auto ptr = mmap(nullptr, usize(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    if (ptr == MAP_FAILED) {
+      return false;
+    }
+
+    madvise(ptr, usize(st.st_size), MADV_SEQUENTIAL);
+    this->data = static_cast<const char *>(ptr);
+    this->length = usize(st.st_size);
+    this->mapped = true;
+    return true;
+  }
+#endif
+
+ public:
+  Source() = default;
+  Source(const Source &) = delete;
+  Source &operator=(const Source &) = delete;
+
+  ~Source() {
+#ifdef BBCODE_HAS_MMAP
+    if (this->mapped) {
+      munmap(const_cast<char *>(this->data), this->length);
+    }
+#endif
+  }
+
+  /// Load from `path`, or standard input if `path` is `-`.
+  bool open(std::string_view path) {
+    if (path == "-") {
+#ifdef BBCODE_HAS_MMAP
+      if (this->map(STDIN_FILENO)) {
+        return true;
+      }
+#endif
+      return this->read_stream(stdin);
+    }
+
+#ifdef BBCODE_HAS_MMAP
+    int fd = ::open(std::string(path).c_str(), O_RDONLY);
+    if (fd < 0) {
+      return false;
+    }
+
+    bool done = this->map(fd);
+    close(fd);
+    if (done) {
+      return true;
+    }
+#endif
+
+    auto file = std::fopen(std::string(path).c_str(), "rb");
+    if (file == nullptr) {
+      return false;
+    }
+
+    bool result = this->read_stream(file);
+    std::fclose(file);
+    return result;
+  }
+
+  [[nodiscard]] std::string_view view() const noexcept {
+    return {this->data, this->length};
+  }
+
+  /// Content of line `n` (0 based), without line break.
+  std::string_view line(usize n) {
+    auto source = this->view();
+    while (this->line_starts.size() <= n + 1 && this->scanned < this->length) {
+      auto next = std::find(source.begin() + isize(this->scanned), source.end(), '\n');
+      this->scanned = usize(next - source.begin());
+      if (next != source.end()) {
+        this->line_starts.push_back(++this->scanned);
+      }
+    }
+
+    if (n >= this->line_starts.size()) {
+      return {};
+    }
+
+    auto start = this->line_starts[n];
+    auto end = n + 1 < this->line_starts.size() ? this->line_starts[n + 1] - 1 : this->length;
+    return source.substr(start, end - start);
+  }
+};
+
+#endif //BBCODE_TOOLS_SOURCE_H_
@@ -0,0 +1,72 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+
+#include "writer.h"
+
+using namespace bbcode::lexer;
+using namespace bbcode::parser;
+using namespace bbcode::writer;
+
+int main(int argc, char ** argv) {
+  std::istream* input = &std::cin;
+  std::ostream* output = &std::cout;
+
+  std::ifstream file_in;
+  std::ofstream file_out;
+
+  if (argc >= 2) {
+    auto i = std::string_view(argv[1]);
+    if (i != "-") {
+      file_in = std::ifstream(i.data(), std::ios::binary);
+      if (file_in.is_open()) {
+        input = &file_in;
+      } else {
+        std::cerr << "Failed opening file: " << i << " for read." << std::endl;
+        exit(1);
+      }
+    }
+  }
+
+  if (argc >= 3) {
+    auto o = std::string_view(argv[2]);
+    if (o != "-") {
+      file_out = std::ofstream(o.data(), std::ios::binary | std::ios::trunc);
+      if (file_out.is_open()) {
+        output = &file_out;
+      } else {
+        std::cerr << "Failed opening file: " << o << " for write." << std::endl;
+        exit(1);
+      }
+    }
+  }
+
+  Parser parser(Writer(output), [](Message&&) {});
+  parser.set_severities(0);
+  ChunkLexer lexer([&parser](const LexView& item) {
+    parser.put(item);
+  });
+
+  std::vector<char> chunk(64 << 10);
+  while (input->good()) {
+    input->read(chunk.data(), isize(chunk.size()));
+    lexer.put(std::string_view(chunk.data(), usize(input->gcount())));
+  }
+
+  lexer.finish();
+
+  if (!output->good()) {
+    std::cerr << "Failed writing output." << std::endl;
+    exit(1);
+  }
+
+  if (file_in.is_open()) {
+    file_in.close();
+  }
+
+  if (file_out.is_open()) {
+    file_out.close();
+  }
+
+  return 0;
+}
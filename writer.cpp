@@ -0,0 +1,421 @@
+#include "writer.h"
+#include <array>
+#include <cassert>
+#include <unordered_map>
+
+namespace bbcode::writer {
+
+static auto NodeTypeNames = std::array {
+    "Invalid",
+    "Omission",
+    "Simple",
+    "Parametric",
+    "Greedy",
+    "Verbatim",
+    "Literal",
+    "Constant",
+    "Newline",
+    "End"
+};
+
+static auto NodeTypeNamesBase = &NodeTypeNames[1];
+
+static void write_children(const Node &node, std::ostream *o) {
+  for (const auto &child : node.children) {
+    write_bbcode(child, o);
+  }
+}
+
+void write_bbcode(const Node &node, std::ostream *o) {
+  switch (node.type) {
+    case grammar::Literal:
+    case grammar::Constant:
+      *o << node.data;
+      break;
+    case grammar::Newline:
+      *o << '\n';
+      break;
+    case grammar::Omission:
+      *o << '[' << node.name << ']';
+      break;
+    case grammar::Greedy:
+      // terminated by next sibling or parent close tag.
+      *o << '[' << node.name << ']';
+      write_children(node, o);
+      break;
+    case grammar::Simple:
+    case grammar::Verbatim:
+      *o << '[' << node.name << ']';
+      write_children(node, o);
+      *o << "[/" << node.name << ']';
+      break;
+    case grammar::Parametric:
+      *o << '[' << node.name << '=' << node.data << ']';
+      write_children(node, o);
+      *o << "[/" << node.name << ']';
+      break;
+    case grammar::Invalid:
+      // tag part of an Invalid node is never rendered, so drop it and
+      // keep only the text. Verbatim text would be markup without its tag,
+      // so that one is kept.
+      if (!node.data.empty()) {
+        *o << node.data;
+      } else if (grammar::get_descriptor(node.name, grammar::Verbatim) != grammar::NODE_MAP.end()) {
+        *o << '[' << node.name << ']';
+        write_children(node, o);
+        *o << "[/" << node.name << ']';
+      } else {
+        write_children(node, o);
+      }
+      break;
+    case grammar::End:
+      assert(false);
+  }
+}
+
+void write_json_escape(std::string_view s, std::ostream *o) {
+  static const char HEX[] = "0123456789abcdef";
+
+  for (const auto &c : s) {
+    switch (c) {
+      case '"':
+        *o << "\\\"";
+        break;
+      case '\\':
+        *o << "\\\\";
+        break;
+      case '\r':
+        *o << "\\r";
+        break;
+      case '\n':
+        *o << "\\n";
+        break;
+      case '\t':
+        *o << "\\t";
+        break;
+      default:
+        if (u8(c) < 0x20) {
+          *o << "\\u00" << HEX[c >> 4] << HEX[c & 0xf];
+        } else {
+          *o << c;
+        }
+        break;
+    }
+  }
+}
+
+static void write_json_children(const Node &node, std::ostream *o) {
+  *o << R"(,"content":[)";
+  for (auto it = node.children.begin(); it != node.children.end(); ++it) {
+    write_json(*it, o);
+    if (it + 1 != node.children.end()) {
+      *o << ",";
+    }
+  }
+  *o << "]";
+}
+
+void write_json(const Node &node, std::ostream *o) {
+  *o << R"({"type":")" << *(NodeTypeNamesBase + node.type)
+     << R"(","line":)" << node.line << R"(,"chr":)" << node.chr
+     << R"(,"offset":)" << node.offset << R"(,"span":)" << node.span;
+  switch (node.type) {
+    case grammar::Literal:
+    case grammar::Constant: {
+      *o << R"(,"content":")";
+      write_json_escape(node.data, o);
+      *o << "\"}";
+      break;
+    }
+    case grammar::Omission:
+      *o << R"(,"name":")" << node.name << "\"}";
+      break;
+    case grammar::Simple:
+    case grammar::Greedy:
+    case grammar::Verbatim: {
+      *o << R"(,"name":")" << node.name << "\"";
+      write_json_children(node, o);
+      *o << "}";
+      break;
+    }
+    case grammar::Parametric: {
+      *o << R"(,"name":")" << node.name << "\"";
+      *o << R"(,"parameter":")";
+      write_json_escape(node.data, o);
+      *o << "\"";
+      write_json_children(node, o);
+      *o << "}";
+      break;
+    }
+    case grammar::Newline:
+      *o << "}";
+      break;
+    case grammar::Invalid: {
+      *o << R"(,"name":")";
+      write_json_escape(node.name, o);
+      *o << "\"";
+      if (!node.data.empty()) {
+        *o << R"(,"content":")";
+        write_json_escape(node.data, o);
+        *o << "\"";
+      } else if (!node.children.empty()) {
+        write_json_children(node, o);
+      }
+      *o << "}";
+      break;
+    }
+    case grammar::End:
+      assert(false);
+  }
+}
+
+static void write_html_escape(std::string_view s, std::ostream *o) {
+  for (const auto &c : s) {
+    switch (c) {
+      case '&':
+        *o << "&amp;";
+        break;
+      case '<':
+        *o << "&lt;";
+        break;
+      case '>':
+        *o << "&gt;";
+        break;
+      case '"':
+        *o << "&quot;";
+        break;
+      case '\'':
+        *o << "&#39;";
+        break;
+      default:
+        *o << c;
+        break;
+    }
+  }
+}
+
+// parameters are validated, but font names are only trimmed.
+static void write_css_value(std::string_view s, std::ostream *o) {
+  for (const auto &c : s) {
+    if (('0' <= c && c <= '9') || ('a' <= c && c <= 'z') ||
+        ('A' <= c && c <= 'Z') || c == ' ' || c == ',' || c == '#' ||
+        c == '.' || c == '%' || c == '-' || c == '_') {
+      *o << c;
+    }
+  }
+}
+
+static bool safe_url(std::string_view url) {
+  auto colon = url.find(':');
+  if (colon == std::string_view::npos ||
+      url.find_first_of("/?#") < colon) {
+    return true;
+  }
+
+  std::string scheme;
+  for (const auto &c : url.substr(0, colon)) {
+    scheme += char(std::tolower(static_cast<unsigned char>(c)));
+  }
+
+  return scheme == "http" || scheme == "https" || scheme == "ftp" ||
+      scheme == "mailto";
+}
+
+static const std::unordered_map<std::string, std::pair<const char *, const char *>,
+                                grammar::StringHash, grammar::StringEqual> HTML_TAGS = {
+    {"b", {"<b>", "</b>"}},
+    {"i", {"<i>", "</i>"}},
+    {"x", {"<s>", "</s>"}},
+    {"center", {R"(<div style="text-align:center">)", "</div>"}},
+    {"hr", {"<hr>", ""}},
+    {"code", {"<pre><code>", "</code></pre>"}},
+    {"list", {"<ul>", "</ul>"}},
+    {"*", {"<li>", "</li>"}},
+    {"table", {"<table>", "</table>"}},
+    {"tr", {"<tr>", "</tr>"}},
+    {"td", {"<td>", "</td>"}},
+};
+
+// writes the open tag and returns the close tag
+static const char *write_html_open(grammar::NodeType type, std::string_view name, std::string_view data,
+                                   std::ostream *o) {
+  switch (type) {
+    case grammar::Omission:
+    case grammar::Simple:
+    case grammar::Greedy:
+    case grammar::Verbatim: {
+      auto tag = HTML_TAGS.find(name);
+      assert(tag != HTML_TAGS.end());
+      *o << tag->second.first;
+      return tag->second.second;
+    }
+    case grammar::Parametric: {
+      const char *close = "</span>";
+      if (name == "font") {
+        *o << R"(<span style="font-family:)";
+        write_css_value(data, o);
+        *o << "\">";
+      } else if (name == "size") {
+        if (data.size() == 1 && '1' <= data[0] && data[0] <= '7') {
+          *o << R"(<font size=")" << data << "\">";
+          close = "</font>";
+        } else {
+          *o << R"(<span style="font-size:)";
+          write_css_value(data, o);
+          *o << "\">";
+        }
+      } else if (name == "color") {
+        *o << R"(<span style="color:)";
+        write_css_value(data, o);
+        *o << "\">";
+      } else if (name == "url") {
+        if (safe_url(data)) {
+          *o << R"(<a href=")";
+          write_html_escape(data, o);
+          *o << R"(" rel="nofollow">)";
+          close = "</a>";
+        } else {
+          close = "";
+        }
+      } else if (name == "list") {
+        *o << R"(<ol type=")";
+        write_html_escape(data, o);
+        *o << "\">";
+        close = "</ol>";
+      } else if (name == "table") {
+        *o << R"(<table style="background-color:)";
+        write_css_value(data, o);
+        *o << "\">";
+        close = "</table>";
+      } else {
+        assert(false);
+      }
+      return close;
+    }
+    default:
+      assert(false);
+      return "";
+  }
+}
+
+static void write_html_children(const Node &node, std::ostream *o) {
+  for (const auto &child : node.children) {
+    if (node.type == grammar::Verbatim && child.type == grammar::Newline) {
+      *o << '\n';
+    } else {
+      write_html(child, o);
+    }
+  }
+}
+
+void write_html(const Node &node, std::ostream *o) {
+  switch (node.type) {
+    case grammar::Literal:
+      write_html_escape(node.data, o);
+      break;
+    case grammar::Constant:
+      *o << R"(<span class="emoticon">)";
+      write_html_escape(node.data, o);
+      *o << "</span>";
+      break;
+    case grammar::Newline:
+      *o << "<br>";
+      break;
+    case grammar::Omission:
+    case grammar::Simple:
+    case grammar::Greedy:
+    case grammar::Verbatim:
+    case grammar::Parametric: {
+      auto close = write_html_open(node.type, node.name, node.data, o);
+      write_html_children(node, o);
+      *o << close;
+      break;
+    }
+    case grammar::Invalid:
+      // as in `write_bbcode`, the tag is dropped and the text kept
+      if (!node.data.empty()) {
+        write_html_escape(node.data, o);
+      } else {
+        write_html_children(node, o);
+      }
+      break;
+    case grammar::End:
+      assert(false);
+  }
+}
+
+static void write_varint(usize value, std::ostream *o) {
+  while (value >= 0x80) {
+    o->put(char(u8(value) | 0x80));
+    value >>= 7;
+  }
+  o->put(char(value));
+}
+
+static void write_bytes(std::string_view s, std::ostream *o) {
+  write_varint(s.size(), o);
+  o->write(s.data(), isize(s.size()));
+}
+
+void write_binary(const Node &node, std::ostream *o) {
+  o->put(char(node.type + 1));
+  write_varint(node.line, o);
+  write_varint(node.chr, o);
+  write_varint(node.offset, o);
+  write_varint(node.span, o);
+  write_bytes(node.name, o);
+  write_bytes(node.data, o);
+  write_varint(node.children.size(), o);
+  for (const auto &child : node.children) {
+    write_binary(child, o);
+  }
+}
+
+void HtmlWriter::operator()(const Event &event) {
+  switch (event.type) {
+    case parser::Enter:
+      if (event.node == grammar::Invalid) {
+        this->open.emplace_back("", false);
+      } else {
+        this->open.emplace_back(write_html_open(event.node, event.name, event.data, this->output),
+                                event.node == grammar::Verbatim);
+      }
+      break;
+    case parser::Leave:
+      *this->output << this->open.back().first;
+      this->open.pop_back();
+      break;
+    case parser::Leaf:
+      switch (event.node) {
+        case grammar::Literal:
+        case grammar::Invalid:
+          write_html_escape(event.data, this->output);
+          break;
+        case grammar::Constant:
+          *this->output << R"(<span class="emoticon">)";
+          write_html_escape(event.data, this->output);
+          *this->output << "</span>";
+          break;
+        case grammar::Newline:
+          *this->output << (!this->open.empty() && this->open.back().second ? "\n" : "<br>");
+          break;
+        default:
+          break;
+      }
+      break;
+    case parser::Finish:
+      this->open.clear();
+      this->output->flush();
+      break;
+  }
+}
+
+void Writer::operator()(Node &&node) {
+  if (node.type == grammar::End) {
+    this->output->flush();
+  } else {
+    write_bbcode(node, this->output);
+  }
+}
+
+}
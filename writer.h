@@ -0,0 +1,64 @@
+#ifndef BBCODE__WRITER_H_
+#define BBCODE__WRITER_H_
+
+#include <ostream>
+#include <vector>
+
+#include "parser.h"
+
+namespace bbcode::writer {
+
+using bbcode::parser::Node;
+using bbcode::parser::Event;
+
+/// Write node back as canonical BBCode.
+///
+/// Parameters are written as normalized by validators, every paired tag is
+/// closed explicitly, and Invalid nodes are reduced to their text so they
+/// will not be picked up as tags again.
+void write_bbcode(const Node &node, std::ostream *o);
+
+/// Write node as JSON object.
+void write_json(const Node &node, std::ostream *o);
+
+/// Write string content escaped for a JSON string literal.
+void write_json_escape(std::string_view s, std::ostream *o);
+
+/// Render node as HTML. Invalid nodes are rendered as their text, with the
+/// tag dropped as in `write_bbcode`.
+void write_html(const Node &node, std::ostream *o);
+
+/// Write node in compact binary form:
+///
+/// u8 type (NodeType + 1), varint line, chr, offset and span,
+/// varint length + bytes of name and data, varint child count, children.
+///
+/// varint is unsigned LEB128.
+void write_binary(const Node &node, std::ostream *o);
+
+/// Streaming form of `write_bbcode`, usable as `Parser` callback.
+class Writer {
+ private:
+  std::ostream *output;
+
+ public:
+  explicit Writer(std::ostream *output) : output(output) {}
+  void operator()(Node &&node);
+};
+
+/// Streaming form of `write_html`, usable as `Parser` event handler. Keeps
+/// only the close tags of open nodes.
+class HtmlWriter {
+ private:
+  std::ostream *output;
+  // close tag and whether it is Verbatim
+  std::vector<std::pair<const char *, bool>> open;
+
+ public:
+  explicit HtmlWriter(std::ostream *output) : output(output) {}
+  void operator()(const Event &event);
+};
+
+}
+
+#endif //BBCODE__WRITER_H_